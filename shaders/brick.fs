@@ -0,0 +1,14 @@
+#version 330 core
+in vec2 TexCoords;
+in vec3 BrickColor;
+flat in float Solid;
+out vec4 color;
+
+uniform sampler2D brick;
+uniform sampler2D solidBrick;
+
+void main()
+{
+    vec4 sampled = Solid > 0.5 ? texture(solidBrick, TexCoords) : texture(brick, TexCoords);
+    color = vec4(BrickColor, 1.0) * sampled;
+}
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec4 rect;   // <vec2 position, vec2 size>
+layout (location = 2) in vec3 color;
+layout (location = 3) in float solid;
+layout (location = 4) in float alive;
+
+out vec2 TexCoords;
+out vec3 BrickColor;
+flat out float Solid;
+
+uniform mat4 projection;
+// level space y at the top of the screen
+uniform float scroll;
+
+void main()
+{
+    TexCoords = vertex.zw;
+    BrickColor = color;
+    Solid = solid;
+    // destroyed bricks collapse into a degenerate quad and produce no fragments
+    vec2 pos = rect.xy + vertex.xy * rect.zw * alive;
+    gl_Position = projection * vec4(pos.x, pos.y - scroll, 0.0, 1.0);
+}
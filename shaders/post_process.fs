@@ -7,9 +7,63 @@ uniform vec2  offsets[9];
 uniform int     edge_kernel[9];
 uniform float  blur_kernel[9];
 
+// EFFECT_DYNAMIC picks the effects with uniforms at runtime; otherwise the program is a variant 
+// specialized by EFFECT_* defines and the branches on these constants are folded away
+#ifdef EFFECT_DYNAMIC
 uniform bool chaos;
 uniform bool confuse;
 uniform bool shake;
+uniform bool fxaa;
+#else
+#ifdef EFFECT_CHAOS
+const bool chaos = true;
+#else
+const bool chaos = false;
+#endif
+#ifdef EFFECT_CONFUSE
+const bool confuse = true;
+#else
+const bool confuse = false;
+#endif
+#ifdef EFFECT_SHAKE
+const bool shake = true;
+#else
+const bool shake = false;
+#endif
+#ifdef EFFECT_FXAA
+const bool fxaa = true;
+#else
+const bool fxaa = false;
+#endif
+#endif
+
+// FXAA-style smoothing: blends along the edge direction estimated from the luma of the 
+// diagonal neighbours, flat regions are returned untouched
+vec4 antialias(vec2 uv)
+{
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    vec3 weights = vec3(0.299, 0.587, 0.114);
+    vec4 center = texture(scene, uv);
+    float lumaNW = dot(texture(scene, uv + vec2(-1.0,  1.0) * texel).rgb, weights);
+    float lumaNE = dot(texture(scene, uv + vec2( 1.0,  1.0) * texel).rgb, weights);
+    float lumaSW = dot(texture(scene, uv + vec2(-1.0, -1.0) * texel).rgb, weights);
+    float lumaSE = dot(texture(scene, uv + vec2( 1.0, -1.0) * texel).rgb, weights);
+    float lumaM  = dot(center.rgb, weights);
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(0.0312, lumaMax * 0.125))
+        return center;
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.03125, 1.0 / 128.0);
+    dir = clamp(dir / (min(abs(dir.x), abs(dir.y)) + reduce), vec2(-8.0), vec2(8.0)) * texel;
+
+    vec3 rgbA = 0.5 * (texture(scene, uv + dir * (1.0 / 3.0 - 0.5)).rgb + 
+                       texture(scene, uv + dir * (2.0 / 3.0 - 0.5)).rgb);
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (texture(scene, uv - dir * 0.5).rgb + texture(scene, uv + dir * 0.5).rgb);
+    float lumaB = dot(rgbB, weights);
+    return vec4((lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB, center.a);
+}
 
 void main()
 {
@@ -39,6 +93,10 @@ void main()
             color += vec4(sample[i] * blur_kernel[i], 0.0f);
         color.a = 1.0f;
     }
+    else if(fxaa)
+    {
+        color = antialias(TexCoords);
+    }
     else
     {
         color =  texture(scene, TexCoords);
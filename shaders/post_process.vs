@@ -3,9 +3,29 @@ layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
 
 out vec2 TexCoords;
 
+// EFFECT_DYNAMIC picks the effects with uniforms at runtime; otherwise the program is a variant 
+// specialized by EFFECT_* defines and the branches on these constants are folded away
+#ifdef EFFECT_DYNAMIC
 uniform bool chaos;
 uniform bool confuse;
 uniform bool shake;
+#else
+#ifdef EFFECT_CHAOS
+const bool chaos = true;
+#else
+const bool chaos = false;
+#endif
+#ifdef EFFECT_CONFUSE
+const bool confuse = true;
+#else
+const bool confuse = false;
+#endif
+#ifdef EFFECT_SHAKE
+const bool shake = true;
+#else
+const bool shake = false;
+#endif
+#endif
 uniform float time;
 
 void main()
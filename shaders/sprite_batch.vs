@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec4 vertex;        // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec4 rect;          // <vec2 position, vec2 size>
+layout (location = 2) in vec4 colorRotation; // <vec3 color, float rotation in radians>
+
+out vec2 TexCoords;
+out vec3 SpriteColor;
+
+uniform mat4 projection;
+
+void main()
+{
+    TexCoords = vertex.zw;
+    SpriteColor = colorRotation.rgb;
+    // rotate around the center of the quad, then move it into place
+    float c = cos(colorRotation.w);
+    float s = sin(colorRotation.w);
+    vec2 local = (vertex.xy - 0.5) * rect.zw;
+    local = vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+    gl_Position = projection * vec4(rect.xy + 0.5 * rect.zw + local, 0.0, 1.0);
+}
@@ -0,0 +1,153 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// entries are ordered by type, then name
+static bool entryLess(const PackEntry &entry, uint32_t type, const char *name)
+{
+    return entry.Type != type ? entry.Type < type : std::strncmp(entry.Name, name, sizeof(entry.Name)) < 0;
+}
+
+AssetPack::AssetPack()
+    : mapping(nullptr), size(0), entries(nullptr), count(0)
+{
+
+}
+
+AssetPack::~AssetPack()
+{
+    this->Close();
+}
+
+bool AssetPack::Open(const char *path)
+{
+    this->Close();
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return false;
+    struct stat info;
+    if (fstat(file, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(PackHeader))
+    {
+        close(file);
+        return false;
+    }
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping keeps the file alive on its own
+    close(file);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    const PackHeader *header = static_cast<const PackHeader*>(mapping);
+    if (std::memcmp(header->Magic, "BKPK", 4) != 0 || header->Version != PACK_VERSION 
+        || sizeof(PackHeader) + header->EntryCount * sizeof(PackEntry) > static_cast<size_t>(info.st_size))
+    {
+        std::cout << "ERROR::ASSETPACK: " << path << " is not a valid pack, run make pack again" << std::endl;
+        munmap(mapping, info.st_size);
+        return false;
+    }
+    this->mapping = mapping;
+    this->size = info.st_size;
+    this->entries = reinterpret_cast<const PackEntry*>(header + 1);
+    this->count = header->EntryCount;
+    return true;
+}
+
+void AssetPack::Close()
+{
+    if (this->mapping)
+        munmap(this->mapping, this->size);
+    this->mapping = nullptr;
+    this->size = 0;
+    this->entries = nullptr;
+    this->count = 0;
+}
+
+bool AssetPack::IsOpen() const
+{
+    return this->mapping != nullptr;
+}
+
+const PackEntry *AssetPack::Find(const std::string &name, PackEntryType type) const
+{
+    const PackEntry *end = this->entries + this->count;
+    const PackEntry *entry = std::lower_bound(this->entries, end, name.c_str(), 
+        [type](const PackEntry &entry, const char *name) { return entryLess(entry, type, name); });
+    if (entry == end || entry->Type != type || std::strncmp(entry->Name, name.c_str(), sizeof(entry->Name)) != 0)
+        return nullptr;
+    // a truncated pack only loses the entries that no longer fit
+    if (entry->Offset + entry->Size > this->size)
+        return nullptr;
+    return entry;
+}
+
+const unsigned char *AssetPack::Data(const PackEntry &entry) const
+{
+    return static_cast<const unsigned char*>(this->mapping) + entry.Offset;
+}
+
+void AssetPackWriter::Add(const std::string &name, PackEntryType type, uint32_t width, uint32_t height, 
+                            const void *data, size_t size, uint16_t format, uint16_t levels)
+{
+    PackEntry entry = PackEntry();
+    if (name.size() >= sizeof(entry.Name))
+    {
+        std::cout << "ERROR::ASSETPACK: Name too long for a pack entry: " << name << std::endl;
+        return;
+    }
+    std::strncpy(entry.Name, name.c_str(), sizeof(entry.Name) - 1);
+    entry.Type = type;
+    entry.Width = width;
+    entry.Height = height;
+    entry.Format = format;
+    entry.Levels = levels;
+    entry.Size = size;
+    this->entries.push_back(entry);
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    this->blobs.push_back(std::vector<unsigned char>(bytes, bytes + size));
+}
+
+bool AssetPackWriter::Write(const char *path)
+{
+    std::vector<unsigned int> order(this->entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) {
+        return entryLess(this->entries[a], this->entries[b].Type, this->entries[b].Name);
+    });
+
+    // blobs follow the table, each starting at an aligned offset
+    std::vector<PackEntry> table;
+    uint64_t offset = sizeof(PackHeader) + this->entries.size() * sizeof(PackEntry);
+    for (unsigned int index : order)
+    {
+        offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        table.push_back(this->entries[index]);
+        table.back().Offset = offset;
+        offset += table.back().Size;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+    PackHeader header = { { 'B', 'K', 'P', 'K' }, PACK_VERSION, static_cast<uint32_t>(table.size()), 0 };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(PackEntry));
+    for (unsigned int i = 0; i < order.size(); ++i)
+    {
+        // zero padding up to the blob
+        static const char padding[PACK_ALIGNMENT] = { };
+        file.write(padding, table[i].Offset - static_cast<uint64_t>(file.tellp()));
+        const std::vector<unsigned char> &blob = this->blobs[order[i]];
+        file.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,81 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Single file of preprocessed assets, written by tools/asset_packer.cpp ("make pack") and 
+// memory mapped at runtime so resources are uploaded straight from the mapping. Layout: 
+// PackHeader, EntryCount PackEntry records sorted by type and name, then every blob at a 
+// PACK_ALIGNMENT boundary.
+const uint32_t PACK_VERSION = 2;
+const uint32_t PACK_ALIGNMENT = 64;
+
+enum PackEntryType : uint32_t {
+    PACK_TEXTURE,   // Width x Height RGBA8 pixels, decoded
+    PACK_SHADER,    // GLSL source, not null terminated
+    PACK_LEVEL,     // Width x Height uint32_t tile codes, row-major
+    PACK_GLYPHS,    // PackGlyphHeader followed by glyph records, see WriteGlyphRecord
+    PACK_TEXTURE_BC // Width x Height mip chain in the BlockFormat of Format, Levels levels largest first
+};
+
+struct PackHeader {
+    char     Magic[4];
+    uint32_t Version;
+    uint32_t EntryCount;
+    uint32_t Reserved;
+};
+
+struct PackEntry {
+    char     Name[64];      // path of the source asset, e.g. "textures/ball.png"
+    uint32_t Type;
+    uint32_t Width, Height; // texture or level dimensions
+    uint16_t Format;        // BlockFormat of a compressed texture
+    uint16_t Levels;        // mip levels of a compressed texture
+    uint64_t Offset, Size;  // blob position in the file
+};
+
+// distance field glyphs of one font at SDF_GLYPH_SIZE
+struct PackGlyphHeader {
+    uint32_t GlyphSize;
+    uint32_t Spread;
+    uint32_t Count;
+    int32_t  CapHeight;
+};
+
+class AssetPack
+{
+public:
+    AssetPack();
+    ~AssetPack();
+
+    // maps the pack read-only, false if it is missing or not a valid pack
+    bool Open(const char *path);
+    void Close();
+    bool IsOpen() const;
+
+    // entry of a source asset, nullptr if the pack doesn't hold it
+    const PackEntry *Find(const std::string &name, PackEntryType type) const;
+    // points into the mapping, valid until the pack is closed
+    const unsigned char *Data(const PackEntry &entry) const;
+private:
+    void *mapping;
+    size_t size;
+    const PackEntry *entries;
+    uint32_t count;
+};
+
+// collects blobs and writes them out as a pack, used by the packer tool
+class AssetPackWriter
+{
+public:
+    void Add(const std::string &name, PackEntryType type, uint32_t width, uint32_t height, 
+                const void *data, size_t size, uint16_t format = 0, uint16_t levels = 0);
+    bool Write(const char *path);
+private:
+    std::vector<PackEntry> entries;
+    std::vector<std::vector<unsigned char>> blobs;
+};
+
+#endif
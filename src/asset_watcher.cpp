@@ -0,0 +1,151 @@
+#include "asset_watcher.h"
+#include "game_level.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// editors write a file in several steps or replace it, changes are prepared once the
+// directory has been quiet this long
+static const std::chrono::milliseconds SETTLE_TIME(100);
+
+
+void FreeAssetChange(AssetChange &change)
+{
+    if (change.Pixels)
+        stbi_image_free(change.Pixels);
+    change.Pixels = nullptr;
+}
+
+AssetWatcher::AssetWatcher()
+    : fd(-1), running(false)
+{
+
+}
+
+AssetWatcher::~AssetWatcher()
+{
+    this->Stop();
+    for (AssetChange &change : this->ready)
+        FreeAssetChange(change);
+}
+
+bool AssetWatcher::Start(const std::vector<std::string> &directories)
+{
+    this->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->fd < 0)
+    {
+        std::cout << "ERROR::WATCHER: inotify is not available" << std::endl;
+        return false;
+    }
+    for (const std::string &directory : directories)
+    {
+        // closed after writing, or moved in by editors that save to a temporary file first
+        int watch = inotify_add_watch(this->fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch < 0)
+            continue;
+        this->watches.push_back(watch);
+        this->directories.push_back(directory);
+    }
+    if (this->watches.empty())
+    {
+        close(this->fd);
+        this->fd = -1;
+        return false;
+    }
+    this->running = true;
+    this->thread = std::thread(&AssetWatcher::watchLoop, this);
+    return true;
+}
+
+void AssetWatcher::Stop()
+{
+    if (!this->running)
+        return;
+    this->running = false;
+    this->thread.join();
+    close(this->fd);
+    this->fd = -1;
+    this->watches.clear();
+    this->directories.clear();
+}
+
+std::vector<AssetChange> AssetWatcher::Take()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::vector<AssetChange> changes;
+    changes.swap(this->ready);
+    return changes;
+}
+
+void AssetWatcher::watchLoop()
+{
+    std::vector<std::string> changed;
+    auto lastEvent = std::chrono::steady_clock::now();
+    alignas(inotify_event) char buffer[4096];
+    while (this->running)
+    {
+        // short timeout so Stop doesn't wait long for the thread
+        pollfd request = { this->fd, POLLIN, 0 };
+        if (poll(&request, 1, 50) > 0 && (request.revents & POLLIN))
+        {
+            ssize_t length;
+            while ((length = read(this->fd, buffer, sizeof(buffer))) > 0)
+                for (char *pos = buffer; pos < buffer + length; )
+                {
+                    const inotify_event *event = reinterpret_cast<const inotify_event*>(pos);
+                    pos += sizeof(inotify_event) + event->len;
+                    auto watch = std::find(this->watches.begin(), this->watches.end(), event->wd);
+                    if (event->len == 0 || watch == this->watches.end())
+                        continue;
+                    std::string file = this->directories[watch - this->watches.begin()] + "/" + event->name;
+                    if (std::find(changed.begin(), changed.end(), file) == changed.end())
+                        changed.push_back(file);
+                }
+            lastEvent = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (changed.empty() || std::chrono::steady_clock::now() - lastEvent < SETTLE_TIME)
+            continue;
+
+        for (const std::string &file : changed)
+        {
+            AssetChange change = { ASSET_SHADER, file, nullptr, 0, 0, { 0, 0, {} } };
+            if (!this->prepare(file, change))
+                continue;
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->ready.push_back(std::move(change));
+        }
+        changed.clear();
+    }
+}
+
+bool AssetWatcher::prepare(const std::string &file, AssetChange &change)
+{
+    std::string extension = file.substr(std::min(file.rfind('.'), file.size()));
+    if (extension == ".vs" || extension == ".fs" || extension == ".gs")
+    {
+        // a few KB of source, read when the program is recompiled
+        change.Kind = ASSET_SHADER;
+        return true;
+    }
+    if (extension == ".png" || extension == ".jpg" || extension == ".jpeg")
+    {
+        int nrChannels;
+        change.Kind = ASSET_TEXTURE;
+        change.Pixels = stbi_load(file.c_str(), &change.Width, &change.Height, &nrChannels, 4);
+        return change.Pixels != nullptr;
+    }
+    if (extension == ".lvl")
+    {
+        change.Kind = ASSET_LEVEL;
+        change.Tiles = GameLevel::ReadTiles(file.c_str());
+        return change.Tiles.Height > 0;
+    }
+    return false;
+}
@@ -0,0 +1,59 @@
+#ifndef ASSET_WATCHER_H
+#define ASSET_WATCHER_H
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "level_parser.h"
+
+enum AssetKind {
+    ASSET_SHADER,
+    ASSET_TEXTURE,
+    ASSET_LEVEL
+};
+
+// a changed file, decoded or parsed by the watcher thread; shaders are only reported
+struct AssetChange {
+    AssetKind Kind;
+    std::string File;                               // e.g. "shaders/sprite.fs"
+    // textures: RGBA8, owned by the change until FreeAssetChange
+    unsigned char *Pixels;
+    int Width, Height;
+    // levels: parsed tile codes
+    LevelTiles Tiles;
+};
+
+// releases the decoded pixels of a texture change
+void FreeAssetChange(AssetChange &change);
+
+// Watches asset directories with inotify and prepares every file written to them on its own
+// thread (textures decoded, levels parsed), so the render loop only has to swap the results in.
+class AssetWatcher
+{
+public:
+    AssetWatcher();
+    ~AssetWatcher();
+
+    // starts watching the directories, false if none of them can be watched
+    bool Start(const std::vector<std::string> &directories);
+    void Stop();
+
+    // changes prepared since the last call, oldest first
+    std::vector<AssetChange> Take();
+private:
+    int fd;
+    std::vector<int> watches;
+    std::vector<std::string> directories;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::mutex mutex;
+    std::vector<AssetChange> ready;
+
+    void watchLoop();
+    // reads or decodes a file, false if it isn't an asset or can't be read (e.g. half written)
+    bool prepare(const std::string &file, AssetChange &change);
+};
+
+#endif
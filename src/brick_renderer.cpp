@@ -0,0 +1,150 @@
+#include "brick_renderer.h"
+
+#include <algorithm>
+#include <cstddef>
+
+
+BrickRenderer::BrickRenderer(Shader &shader, Texture2D &brick, Texture2D &solid)
+    : shader(shader), brick(brick), solid(solid), count(0), first(0), drawCount(0), boundFirst(0), scroll(0.0f)
+{
+    this->initRenderData();
+}
+
+BrickRenderer::~BrickRenderer()
+{
+    glDeleteVertexArrays(1, &this->quadVAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    glDeleteBuffers(1, &this->instanceVBO);
+}
+
+void BrickRenderer::initRenderData()
+{
+    float vertices[] = { 
+        // pos      tex
+        0.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f, 
+
+        0.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 1.0f,
+        1.0f, 0.0f, 1.0f, 0.0f
+    };
+
+    glGenVertexArrays(1, &this->quadVAO);
+    glGenBuffers(1, &this->quadVBO);
+    glGenBuffers(1, &this->instanceVBO);
+
+    glBindVertexArray(this->quadVAO);
+
+    // shared quad mesh
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+    // per-instance attributes, advanced once per brick
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    for (unsigned int attribute = 1; attribute <= 4; ++attribute)
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+    this->pointInstances(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void BrickRenderer::pointInstances(unsigned int first)
+{
+    size_t base = sizeof(BrickInstance) * first;
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(BrickInstance), (void*)(base + offsetof(BrickInstance, Rect)));
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(BrickInstance), (void*)(base + offsetof(BrickInstance, Color)));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(BrickInstance), (void*)(base + offsetof(BrickInstance, Solid)));
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(BrickInstance), (void*)(base + offsetof(BrickInstance, Alive)));
+    this->boundFirst = first;
+}
+
+void BrickRenderer::Load(std::vector<GameObject> &bricks, WorkerPool *pool)
+{
+    this->instances.resize(bricks.size());
+    auto build = [this, &bricks](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i)
+        {
+            const GameObject &tile = bricks[i];
+            BrickInstance &instance = this->instances[i];
+            instance.Rect = glm::vec4(tile.Position, tile.Size);
+            instance.Color = tile.Color;
+            instance.Solid = tile.IsSolid ? 1.0f : 0.0f;
+            instance.Alive = tile.Destroyed ? 0.0f : 1.0f;
+        }
+    };
+    if (pool)
+        pool->ParallelFor(bricks.size(), 1024, build);
+    else
+        build(0, bricks.size());
+    this->count = this->instances.size();
+    this->first = 0;
+    this->drawCount = this->count;
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(BrickInstance) * this->instances.size(), this->instances.data(), 
+                    GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BrickRenderer::SetAlive(unsigned int index, bool alive)
+{
+    if (index >= this->count)
+        return;
+    float value = alive ? 1.0f : 0.0f;
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(BrickInstance) * index + offsetof(BrickInstance, Alive), 
+                        sizeof(float), &value);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BrickRenderer::SetRange(unsigned int first, unsigned int count)
+{
+    this->first = std::min(first, this->count);
+    this->drawCount = std::min(count, this->count - this->first);
+}
+
+void BrickRenderer::SetScroll(float scroll)
+{
+    this->scroll = scroll;
+}
+
+void BrickRenderer::Draw()
+{
+    if (this->drawCount == 0)
+        return;
+    this->shader.Use();
+    this->shader.SetFloat("scroll", this->scroll);
+
+    glActiveTexture(GL_TEXTURE1);
+    this->solid.Bind();
+    glActiveTexture(GL_TEXTURE0);
+    this->brick.Bind();
+
+    glBindVertexArray(this->quadVAO);
+    if (this->boundFirst != this->first)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+        this->pointInstances(this->first);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, this->drawCount);
+    glBindVertexArray(0);
+}
+
+void BrickRenderer::Submit(RenderQueue &queue, RenderLayer layer)
+{
+    // binds two textures itself, so the queue leaves shader and texture state to it
+    queue.Submit(layer, BLEND_ALPHA, 0, 0, &BrickRenderer::execute, this);
+}
+
+void BrickRenderer::execute(void *owner, const RenderCommand *commands, unsigned int count)
+{
+    static_cast<BrickRenderer*>(owner)->Draw();
+}
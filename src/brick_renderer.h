@@ -0,0 +1,68 @@
+#ifndef BRICK_RENDERER_H
+#define BRICK_RENDERER_H
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "texture.h"
+#include "shader.h"
+#include "game_object.h"
+#include "render_queue.h"
+#include "worker_pool.h"
+
+// per-instance brick state as laid out in the GPU instance buffer
+struct BrickInstance {
+    glm::vec4 Rect;     // position (xy) and size (zw)
+    glm::vec3 Color;
+    float     Solid;    // selects the solid brick texture
+    float     Alive;    // 0 once the brick is destroyed
+};
+
+// Keeps every brick of the current level resident in a static instance buffer,
+// only the instances that change are re-uploaded and the visible range is drawn at once.
+class BrickRenderer
+{
+public:
+    BrickRenderer(Shader &shader, Texture2D &brick, Texture2D &solid);
+    ~BrickRenderer();
+
+    // uploads all bricks of a level, replacing the previous contents; the instance 
+    // data is built on the pool's workers when one is given
+    void Load(std::vector<GameObject> &bricks, WorkerPool *pool = nullptr);
+
+    // updates the alive flag of a single instance
+    void SetAlive(unsigned int index, bool alive);
+
+    // draws only the instances [first, first + count) from now on, e.g. the level chunks in view; 
+    // Load resets it to all of them
+    void SetRange(unsigned int first, unsigned int count);
+    // level space y at the top of the screen, bricks are drawn that far up
+    void SetScroll(float scroll);
+
+    // draws the bricks of the range with a single instanced call
+    void Draw();
+
+    // queues the instanced draw on the given layer
+    void Submit(RenderQueue &queue, RenderLayer layer);
+
+private:
+    // Render state
+    Shader shader;
+    Texture2D brick, solid;
+    unsigned int quadVAO, quadVBO, instanceVBO;
+    unsigned int count;
+    unsigned int first, drawCount;
+    // instance the attribute pointers start at, GL 3.3 has no base instance
+    unsigned int boundFirst;
+    float scroll;
+    std::vector<BrickInstance> instances;
+
+    void initRenderData();
+    // points the per-instance attributes at the instance, with the VAO and instance buffer bound
+    void pointInstances(unsigned int first);
+
+    static void execute(void *owner, const RenderCommand *commands, unsigned int count);
+};
+
+#endif
@@ -8,10 +8,19 @@
 #include "particle_generator.h"
 #include "text_renderer.h"
 #include "post_process.h"
-
-#include <sstream>
+#include "brick_renderer.h"
+#include "render_queue.h"
+#include "worker_pool.h"
+#include "stream_buffer.h"
+#include "asset_watcher.h"
+#include "level_cache.h"
+#include "gl_extensions.h"
+
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <algorithm>
+#include <thread>
 
 
 SpriteRenderer *Renderer;
@@ -19,17 +28,50 @@ GameObject *Player;
 ParticleGenerator *Particles;
 TextRenderer *Text;
 PostProcessor *Effects;
+BrickRenderer *BrickBatch;
+RenderQueue *Queue;
+WorkerPool *Pool;
+StreamBuffer *Stream;
+AssetWatcher *Watcher;
+LevelCache *Levels;
+// parsed levels kept around, the selected one and its neighbours at least
+const unsigned int LEVEL_CACHE_SIZE = 8;
+
+// programs recompiled for a hot reload, swapped in once the driver finished them
+struct ShaderReload {
+    ShaderID ID;
+    std::string File;
+    Shader Program;
+    bool Polled;    // ApplyReloads looked at it in an earlier frame
+};
+std::vector<ShaderReload> ShaderReloads;
+// prepared changes that didn't fit in the previous frame's budget
+std::vector<AssetChange> PendingChanges;
+const double HOT_RELOAD_BUDGET_MS = 4.0;
+
+// HUD and debug overlay labels, formatted in place every frame
+TextLabel BallsLabel, BricksLabel, ReportLabel, GlyphLabel, PostProcessLabel, PostTimingLabel, TextureLabel;
+TextLabel PlayerPositionLabel, PlayerVelocityLabel, BallPositionLabel, BallVelocityLabel;
+std::vector<TextLabel> BrickLabels;
 
 //Effect time
 float ShakeTime = 0.0f;
 
+// Scrolling levels: bricks live in level space and the camera shows the band [CameraY, CameraY + Height) 
+// of it; paddle, ball, power-ups and particles stay in screen space
+float CameraY = 0.0f;
+const float SCROLL_ROW_HEIGHT = 32.0f;
+const float CAMERA_SPEED = 150.0f;
+
 const glm::vec2 INITIAL_BALL_VELOCITY(100.0f, -350.0f);
 const float BALL_RADIUS = 12.5f;
 
 BallObject *Ball;
 
 Game::Game(unsigned int width, unsigned int height) 
-    : State(GAME_MENU), Keys(), Width(width), Height(height)
+    : State(GAME_MENU), Keys(), Width(width), Height(height), Level(0), 
+        WorkerThreads(std::max(std::thread::hardware_concurrency(), 1u) - 1), Samples(4), FXAA(false), HotReload(false), 
+        Scrolling(false)
 { 
 
 }
@@ -42,91 +84,240 @@ Game::~Game()
     delete Particles;
     delete Effects;
     delete Text;
+    delete BrickBatch;
+    delete Queue;
+    delete Pool;
+    delete Stream;
+    delete Watcher;
+    delete Levels;
+    for (AssetChange &change : PendingChanges)
+        FreeAssetChange(change);
 }
 
 void Game::Init()
 {
+    // started first, the workers already decode textures
+    Pool = this->WorkerThreads > 0 ? new WorkerPool(this->WorkerThreads) : nullptr;
+    // one mapped file replaces the loose assets once "make pack" was run
+    if (ResourceManager::OpenPack("assets.pack"))
+        std::cout << "Assets: loading from assets.pack" << std::endl;
 
     this->LoadShaders();
     this->LoadTextures(); 
     this->LoadLevels();
     this->ConfigureGameObjects();
+
+    if (this->HotReload)
+    {
+        Watcher = new AssetWatcher();
+        if (Watcher->Start({ "shaders", "textures", "levels" }))
+            std::cout << "Assets: watching shaders/, textures/ and levels/ for changes" << std::endl;
+    }
+}
+
+void Game::ApplyReloads()
+{
+    if (!Watcher)
+        return;
+    auto start = std::chrono::steady_clock::now();
+
+    // a program that failed to compile or link leaves the running one in place
+    for (auto iter = ShaderReloads.begin(); iter != ShaderReloads.end(); )
+    {
+        // without parallel compile support Ready is always true and the link check below waits 
+        // for the driver, so a program gets one more frame to finish on a threaded driver first
+        if (!iter->Program.Ready() || (!iter->Polled && !GLExtensions::ParallelShaderCompile))
+        {
+            iter->Polled = true;
+            ++iter;
+            continue;
+        }
+        static const ShaderID postProcessing = ResourceManager::FindShader("postprocessing");
+        if (ResourceManager::ReplaceShader(iter->ID, iter->Program))
+        {
+            std::cout << "Reloaded " << iter->File << std::endl;
+            // its specialized variants are compiled by the post processor from the same files
+            if (iter->ID == postProcessing)
+                Effects->SetSources(ResourceManager::ReadFile("shaders/post_process.vs"), 
+                                    ResourceManager::ReadFile("shaders/post_process.fs"));
+        }
+        else
+            std::cout << "ERROR::RELOAD: " << iter->File << " failed, keeping the previous version" << std::endl;
+        iter = ShaderReloads.erase(iter);
+    }
+
+    std::vector<AssetChange> changes = Watcher->Take();
+    PendingChanges.insert(PendingChanges.end(), std::make_move_iterator(changes.begin()), 
+                            std::make_move_iterator(changes.end()));
+    // the decoding happened on the watcher thread, what is left is uploading; once the budget is 
+    // spent the rest waits for the next frame
+    unsigned int applied = 0;
+    while (applied < PendingChanges.size() && 
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < HOT_RELOAD_BUDGET_MS)
+        this->ReloadAsset(PendingChanges[applied++]);
+    PendingChanges.erase(PendingChanges.begin(), PendingChanges.begin() + applied);
+}
+
+void Game::ReloadAsset(AssetChange &change)
+{
+    if (change.Kind == ASSET_SHADER)
+    {
+        for (ShaderID id : ResourceManager::ShadersUsing(change.File))
+        {
+            // a newer save supersedes a compile still in flight
+            for (auto iter = ShaderReloads.begin(); iter != ShaderReloads.end(); ++iter)
+                if (iter->ID == id)
+                {
+                    glDeleteProgram(iter->Program.ID);
+                    ShaderReloads.erase(iter);
+                    break;
+                }
+            ShaderReloads.push_back({ id, change.File, ResourceManager::RecompileShader(id), false });
+        }
+    }
+    else if (change.Kind == ASSET_TEXTURE)
+    {
+        if (ResourceManager::ReloadTexture(change.File, change.Pixels, change.Width, change.Height) > 0)
+            std::cout << "Reloaded " << change.File << std::endl;
+        FreeAssetChange(change);
+    }
+    else if (change.Kind == ASSET_LEVEL)
+    {
+        if (this->ActiveLevel.File == change.File)
+        {
+            this->BuildLevel(change.Tiles.View());
+            this->UploadBricks();
+        }
+        Levels->Store(change.File, change.Tiles);
+        std::cout << "Reloaded " << change.File << std::endl;
+    }
 }
 
 void Game::LoadShaders()
 {
     ResourceManager::LoadShader("shaders/sprite.vs", "shaders/sprite.fs", nullptr, "sprite");
+    ResourceManager::LoadShader("shaders/sprite_batch.vs", "shaders/sprite_batch.fs", nullptr, "sprite_batch");
     ResourceManager::LoadShader("shaders/particle.vs", "shaders/particle.fs", nullptr, "particle");
-    ResourceManager::LoadShader("shaders/post_process.vs", "shaders/post_process.fs", nullptr, "postprocessing");
+    // the post processor compiles specialized variants of this one itself
+    ResourceManager::LoadShader("shaders/post_process.vs", "shaders/post_process.fs", nullptr, "postprocessing", 
+                                "#define EFFECT_DYNAMIC\n");
+    ResourceManager::LoadShader("shaders/brick.vs", "shaders/brick.fs", nullptr, "brick");
+    ResourceManager::LoadShader("shaders/text_2d.vs", "shaders/text_2d.fs", nullptr, "text");
+    // every program not restored from the binary cache was compiling meanwhile
+    ResourceManager::FinishShaders();
     
     // configure shaders
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(this->Width), 
         static_cast<float>(this->Height), 0.0f, -1.0f, 1.0f);
     ResourceManager::GetShader("sprite").Use().SetInteger("image", 0);
     ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
+    ResourceManager::GetShader("sprite_batch").Use().SetInteger("image", 0);
+    ResourceManager::GetShader("sprite_batch").SetMatrix4("projection", projection);
     ResourceManager::GetShader("particle").Use().SetMatrix4("projection", projection);
+    ResourceManager::GetShader("brick").Use().SetInteger("brick", 0);
+    ResourceManager::GetShader("brick").SetInteger("solidBrick", 1);
+    ResourceManager::GetShader("brick").SetMatrix4("projection", projection);
     
 }
 
 void Game::LoadTextures()
 {
-    ResourceManager::LoadTexture("textures/starry_background.jpg", false, "background");
-    ResourceManager::LoadTexture("textures/ball.png", true, "ball");
-    ResourceManager::LoadTexture("textures/brick.png", false, "brick");
-    ResourceManager::LoadTexture("textures/brick_solid.png", false, "brick_solid");
-    ResourceManager::LoadTexture("textures/player_paddle.png", true, "paddle");
-    ResourceManager::LoadTexture("textures/star_particle.png", true, "particle");
-    ResourceManager::LoadTexture("textures/speed.png", true, "powerup_speed");
-    ResourceManager::LoadTexture("textures/sticky.png", true, "powerup_sticky");
-    ResourceManager::LoadTexture("textures/increase.png", true, "powerup_increase");
-    ResourceManager::LoadTexture("textures/confuse.png", true, "powerup_confuse");
-    ResourceManager::LoadTexture("textures/chaos.png", true, "powerup_chaos");
-    ResourceManager::LoadTexture("textures/passthrough.png", true, "powerup_passthrough");
+    ResourceManager::QueueTexture("textures/starry_background.jpg", false, "background");
+    ResourceManager::QueueTexture("textures/ball.png", true, "ball");
+    ResourceManager::QueueTexture("textures/brick.png", false, "brick");
+    ResourceManager::QueueTexture("textures/brick_solid.png", false, "brick_solid");
+    ResourceManager::QueueTexture("textures/player_paddle.png", true, "paddle");
+    ResourceManager::QueueTexture("textures/star_particle.png", true, "particle");
+    ResourceManager::QueueTexture("textures/speed.png", true, "powerup_speed");
+    ResourceManager::QueueTexture("textures/sticky.png", true, "powerup_sticky");
+    ResourceManager::QueueTexture("textures/increase.png", true, "powerup_increase");
+    ResourceManager::QueueTexture("textures/confuse.png", true, "powerup_confuse");
+    ResourceManager::QueueTexture("textures/chaos.png", true, "powerup_chaos");
+    ResourceManager::QueueTexture("textures/passthrough.png", true, "powerup_passthrough");
+    // decoded side by side, startup waits for the slowest file rather than all of them in a row
+    ResourceManager::LoadQueuedTextures(Pool);
 
 }
 
 void Game::LoadLevels()
 {
-    GameLevel one; one.Load("levels/one.lvl", this->Width, this->Height / 2);
-    GameLevel two; two.Load("levels/two.lvl", this->Width, this->Height / 2);
-    GameLevel three; three.Load("levels/three.lvl", this->Width, this->Height / 2);
-    GameLevel four; four.Load("levels/four.lvl", this->Width, this->Height / 2);
-    GameLevel five; five.Load("levels/five.lvl", this->Width, this->Height / 2);
-    this->Levels.push_back(one);
-    this->Levels.push_back(two);
-    this->Levels.push_back(three);
-    this->Levels.push_back(four);
-    this->Levels.push_back(five);
-    this->Level = 0;
+    // only the first level is read now, the others when they are selected or prefetched
+    Levels = new LevelCache(LEVEL_CACHE_SIZE);
+    if (Levels->LoadManifest("levels") == 0)
+        std::cout << "ERROR::LEVELS: No levels found in levels/" << std::endl;
+    this->SelectLevel(0);
+}
+
+void Game::SelectLevel(unsigned int level)
+{
+    unsigned int count = Levels->Count();
+    if (level >= count)
+        return;
+    this->Level = level;
+    this->ActiveLevel.File = Levels->File(level);
+    this->BuildLevel(Levels->Get(level)->View());
+    // the menu steps to either neighbour next
+    Levels->Prefetch((level + 1) % count);
+    Levels->Prefetch((level + count - 1) % count);
+}
+
+void Game::BuildLevel(TileView tiles)
+{
+    if (this->Scrolling)
+        this->ActiveLevel.BuildScrolling(tiles, this->Width, SCROLL_ROW_HEIGHT);
+    else
+        this->ActiveLevel.Build(tiles, this->Width, this->Height / 2);
+    CameraY = this->CameraTarget();
+}
+
+float Game::CameraTarget()
+{
+    // the lowest bricks left sit at the middle of the screen, like a level fitted to the top half
+    if (!this->Scrolling)
+        return 0.0f;
+    return std::max(this->ActiveLevel.LowestRemaining() - this->Height / 2.0f, 0.0f);
 }
 
 void Game::ConfigureGameObjects()
 {
     // Player
     glm::vec2 playerPos = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Texture2D myPaddle = ResourceManager::GetTexture("paddle");
+    // everything but the power-ups is on screen all the time, pinned so the texture budget never evicts it
+    Texture2D myPaddle = ResourceManager::AcquireTexture(ResourceManager::FindTexture("paddle"));
     Player = new GameObject(playerPos, PLAYER_SIZE, myPaddle);
     
     // Ball
     glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f);
-    Texture2D myFace = ResourceManager::GetTexture("ball");
+    Texture2D myFace = ResourceManager::AcquireTexture(ResourceManager::FindTexture("ball"));
     Ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, myFace);
     
 
     // set render-specific controls
     Shader mySprite = ResourceManager::GetShader("sprite");
-    Renderer = new SpriteRenderer(mySprite);
-    Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), 
-                                this->Width, this->Height);
+    Shader mySpriteBatch = ResourceManager::GetShader("sprite_batch");
+    Stream = new StreamBuffer(256 * 1024);
+    Renderer = new SpriteRenderer(mySprite, mySpriteBatch, *Stream);
+    Queue = new RenderQueue();
+    Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), "shaders/post_process.vs", 
+                                "shaders/post_process.fs", this->Width, this->Height, this->Samples);
+    this->SetAntialiasing(this->Samples, this->FXAA);
     Particles = new ParticleGenerator(
         ResourceManager::GetShader("particle"), 
-        ResourceManager::GetTexture("particle"), 
-        500
+        ResourceManager::AcquireTexture(ResourceManager::FindTexture("particle")), 
+        500,
+        *Stream
     );
 
-    Text = new TextRenderer(this->Width, this->Height);
+    Text = new TextRenderer(this->Width, this->Height, *Stream);
     Text->Load("fonts/VCR_OSD_MONO.ttf", 24);
 
+    Texture2D myBrick = ResourceManager::AcquireTexture(ResourceManager::FindTexture("brick"));
+    Texture2D mySolidBrick = ResourceManager::AcquireTexture(ResourceManager::FindTexture("brick_solid"));
+    ResourceManager::AcquireTexture(ResourceManager::FindTexture("background"));
+    Shader myBrickShader = ResourceManager::GetShader("brick");
+    BrickBatch = new BrickRenderer(myBrickShader, myBrick, mySolidBrick);
+    this->UploadBricks();
+
 }
 
 void Game::Update(float dt)
@@ -143,6 +334,9 @@ void Game::Update(float dt)
     this->CheckDeath();
     this->CheckWin();
 
+    // cleared rows scroll down out of the way, never faster than the ball can follow
+    CameraY = std::max(this->CameraTarget(), CameraY - CAMERA_SPEED * dt);
+
     if (ShakeTime > 0.0f)
     {
         ShakeTime -= dt;
@@ -165,7 +359,7 @@ void Game::CheckDeath()
 
 void Game::CheckWin()
 {
-  if(this->State == GAME_ACTIVE && this->Levels[this->Level].IsCompleted())
+  if(this->State == GAME_ACTIVE && this->ActiveLevel.IsCompleted())
     {
         Ball->Stuck = true;
         this->State = GAME_WIN;
@@ -205,6 +399,18 @@ void Game::ProcessInput(float dt)
             this->State = GAME_ATTRIBUTES;
     }
     
+    // M cycles the MSAA sample count, F toggles FXAA, in any state
+    if (this->Keys[GLFW_KEY_M] && !this->KeysProcessed[GLFW_KEY_M])
+    {
+        this->SetAntialiasing(this->Samples == 0 ? 2 : this->Samples >= 8 ? 0 : this->Samples * 2, this->FXAA);
+        this->KeysProcessed[GLFW_KEY_M] = true;
+    }
+    if (this->Keys[GLFW_KEY_F] && !this->KeysProcessed[GLFW_KEY_F])
+    {
+        this->SetAntialiasing(this->Samples, !this->FXAA);
+        this->KeysProcessed[GLFW_KEY_F] = true;
+    }
+
     if (this->State == GAME_MENU)
     {
         if (this->Keys[GLFW_KEY_SPACE] && !this->KeysProcessed[GLFW_KEY_SPACE])
@@ -214,15 +420,14 @@ void Game::ProcessInput(float dt)
         }
         if (this->Keys[GLFW_KEY_D] && !this->KeysProcessed[GLFW_KEY_D])
         {
-            this->Level = (this->Level + 1) % 5;
+            this->SelectLevel((this->Level + 1) % std::max(Levels->Count(), 1u));
+            this->UploadBricks();
             this->KeysProcessed[GLFW_KEY_D] = true;
         }
         if (this->Keys[GLFW_KEY_A] && !this->KeysProcessed[GLFW_KEY_A])
         {
-            if (this->Level > 0)
-                --this->Level;
-            else
-                this->Level = 4;
+            this->SelectLevel(this->Level > 0 ? this->Level - 1 : Levels->Count() - 1);
+            this->UploadBricks();
             this->KeysProcessed[GLFW_KEY_A] = true;
         }
     }
@@ -260,98 +465,137 @@ void Game::ProcessInput(float dt)
 
 void Game::Render()
 {
+    unsigned int visibleBegin = 0, visibleEnd = 0;
     if(this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_PAUSE || this->State == GAME_WIN || this->State == GAME_LOSE || this->State == GAME_ATTRIBUTES)
     {
-        Texture2D myBackground = ResourceManager::GetTexture("background");
+        static const TextureID background = ResourceManager::FindTexture("background");
+        Texture2D myBackground = ResourceManager::GetTexture(background);
         
-        Effects->BeginRender();
+        Effects->Submit(*Queue, glfwGetTime());
 
-        Renderer->DrawSprite(myBackground, glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
+        Renderer->SubmitSprite(*Queue, LAYER_BACKGROUND, myBackground, glm::vec2(0.0f, 0.0f), 
+                                glm::vec2(this->Width, this->Height), 0.0f);
         
-        this->Levels[this->Level].Draw(*Renderer);
+        // only the chunks in view are drawn
+        ActiveLevel.BricksIn(CameraY, CameraY + this->Height, visibleBegin, visibleEnd);
+        BrickBatch->SetRange(visibleBegin, visibleEnd - visibleBegin);
+        BrickBatch->SetScroll(CameraY);
+        BrickBatch->Submit(*Queue, LAYER_BRICKS);
         
-        Player->Draw(*Renderer);
+        Player->Submit(*Renderer, *Queue, LAYER_PADDLE);
 
         for (PowerUp &powerUp : this->PowerUps)
                 if (!powerUp.Destroyed)
-                    powerUp.Draw(*Renderer);
+                    powerUp.Submit(*Renderer, *Queue, LAYER_POWERUPS);
         	
-        Particles->Draw();
+        Particles->Submit(*Queue, LAYER_PARTICLES);
         
-        Ball->Draw(*Renderer);
-
-        Effects->EndRender();
-        Effects->Render(glfwGetTime());
+        Ball->Submit(*Renderer, *Queue, LAYER_BALL);
 
         if(this->State == GAME_ACTIVE || this->State == GAME_PAUSE)
         {
-            int bricksDestroyed = 0;
+            BallsLabel.Format("Balls:", this->Lives);
+            BricksLabel.Format("Bricks:", this->ActiveLevel.BricksDestroyed());
 
-            for (GameObject &tile : this->Levels[this->Level].Bricks)
-                if(tile.Destroyed)
-                    bricksDestroyed += 1;
-
-            std::stringstream balls; balls << this->Lives;
-            std::stringstream bricks; bricks << bricksDestroyed;
-
-            Text->RenderText("Balls:" + balls.str(), 5.0f, 5.0f, 1.0f);
-            Text->RenderText("Bricks:" + bricks.str(), 150.0f, 5.0f, 1.0f);
+            Text->SubmitLabel(*Queue, BallsLabel, 5.0f, 5.0f, 1.0f);
+            Text->SubmitLabel(*Queue, BricksLabel, 150.0f, 5.0f, 1.0f);
         }
     }
     if(this->State == GAME_MENU)
     {   
-        Text->RenderText("Press SPACE to Start", 250.0f, Height/2+60.0f, 1.0f);
-        Text->RenderText("Press A or D to select level", 245.0f, Height / 2 + 85.0f, 0.75f);
+        Text->SubmitText(*Queue, "Press SPACE to Start", 250.0f, Height/2+60.0f, 1.0f);
+        Text->SubmitText(*Queue, "Press A or D to select level", 245.0f, Height / 2 + 85.0f, 0.75f);
     }   
     if(this->State == GAME_WIN)
     {
-        Text->RenderText("You Won the game!", 300.0f, Height/2+60.0f, 1.0f);
-        Text->RenderText("Press R to retry or Q to quit", 250.0f, Height / 2 + 85.0f, 0.75f);
+        Text->SubmitText(*Queue, "You Won the game!", 300.0f, Height/2+60.0f, 1.0f);
+        Text->SubmitText(*Queue, "Press R to retry or Q to quit", 250.0f, Height / 2 + 85.0f, 0.75f);
     }
     if(this->State == GAME_LOSE)
     {
-        Text->RenderText("You Lose!", 350.0f, Height/2+60.0f, 1.0f);
-        Text->RenderText("Press R to retry or Q to quit", 250.0f, Height / 2 + 85.0f, 0.75f);
+        Text->SubmitText(*Queue, "You Lose!", 350.0f, Height/2+60.0f, 1.0f);
+        Text->SubmitText(*Queue, "Press R to retry or Q to quit", 250.0f, Height / 2 + 85.0f, 0.75f);
     }
     if(this->State == GAME_PAUSE)
     {
-        Text->RenderText("PAUSE", 360.0f, Height/2, 1.0f);
+        Text->SubmitText(*Queue, "PAUSE", 360.0f, Height/2, 1.0f);
     }
     
     if(this->State == GAME_ATTRIBUTES)
     {   
-        std::stringstream playerX; playerX << Player->Position.x;
-        std::stringstream playerY; playerY << Player->Position.y;
-        std::stringstream playerV; playerV << this->PaddleVelocity;
-
-        std::stringstream ballX; ballX << Ball->Position.x;
-        std::stringstream ballY; ballY << Ball->Position.y;
-        std::stringstream ballVx; ballVx << Ball->Velocity.x;
-        std::stringstream ballVy; ballVy << Ball->Velocity.y;
-
-        //Text->RenderText("ATTRIBUTES:", 5.0f, 5.0f, 1.0f);
-        Text->RenderText("X:" + playerX.str() + ", Y:" + playerY.str(), Player->Position.x+5.0f, Player->Position.y-20.0f, 0.4f);
-        Text->RenderText("V: " + playerV.str(), Player->Position.x+5.0f, Player->Position.y-10.0f, 0.4f);
-        Text->RenderText("X: " + ballX.str() + ",Y: " + ballY.str(), Ball->Position.x+35.0f, Ball->Position.y+5.0f, 0.4f);
-        Text->RenderText("V: (" + ballVx.str() + "," + ballVy.str() + ")", Ball->Position.x+35.0f, Ball->Position.y+15.0f, 0.4f);
-
-        for (GameObject &box : this->Levels[this->Level].Bricks)
+        // render queue report of the previous frame
+        const RenderStats &stats = Queue->Stats;
+        ReportLabel.Format("Commands:", stats.Commands, " Batches:", stats.Batches, " Switches:", 
+                            stats.ShaderSwitches + stats.TextureSwitches + stats.BlendSwitches, 
+                            " (shader ", stats.ShaderSwitches, ", texture ", stats.TextureSwitches, 
+                            ", blend ", stats.BlendSwitches, ") Workers:", Pool ? Pool->Threads() : 0u, 
+                            " Orphans:", Stream->Orphans);
+        const GlyphCacheStats &glyphs = Text->GlyphStats;
+        unsigned int lookups = glyphs.Hits + glyphs.Misses;
+        GlyphLabel.Format("Glyphs:", glyphs.Resident, "/", GLYPH_SLOTS, " Hits:", glyphs.Hits, " Misses:", glyphs.Misses, 
+                            " (", lookups ? 100.0f * glyphs.Hits / lookups : 0.0f, "% hit) Evictions:", glyphs.Evictions);
+        const PostProcessStats &post = Effects->Stats;
+        // the timings get their own line, together they don't fit one label
+        PostProcessLabel.Format("MSAA:", Effects->Samples, Effects->FXAA ? " FXAA" : "", " Post:", 
+                                post.Offscreen ? (post.Specialized ? "specialized" : "dynamic") : "direct", 
+                                " Skipped:", post.SkippedFrames);
+        PostTimingLabel.Format("GPU ", post.GpuMs, "ms CPU ", post.CpuMs, "ms Saved GPU ", 
+                                static_cast<float>(post.SavedGpuMs), "ms CPU ", static_cast<float>(post.SavedCpuMs), "ms");
+        const TextureResidency &residency = ResourceManager::Residency;
+        TextureLabel.Format("Textures:", residency.Resident, " ", static_cast<unsigned int>(residency.ResidentBytes / 1024), 
+                            "KB Budget:", static_cast<unsigned int>(residency.BudgetBytes / 1024), "KB Evictions:", 
+                            residency.Evictions, " Reload stalls:", residency.ReloadStalls, " (", 
+                            static_cast<float>(residency.StallMs), "ms)");
+        PlayerPositionLabel.Format("X:", Player->Position.x, ", Y:", Player->Position.y);
+        PlayerVelocityLabel.Format("V: ", this->PaddleVelocity);
+        BallPositionLabel.Format("X: ", Ball->Position.x, ",Y: ", Ball->Position.y);
+        BallVelocityLabel.Format("V: (", Ball->Velocity.x, ",", Ball->Velocity.y, ")");
+
+        Text->SubmitLabel(*Queue, ReportLabel, 5.0f, 5.0f, 0.5f);
+        Text->SubmitLabel(*Queue, GlyphLabel, 5.0f, 20.0f, 0.5f);
+        Text->SubmitLabel(*Queue, PostProcessLabel, 5.0f, 35.0f, 0.5f);
+        Text->SubmitLabel(*Queue, PostTimingLabel, 5.0f, 50.0f, 0.5f);
+        Text->SubmitLabel(*Queue, TextureLabel, 5.0f, 65.0f, 0.5f);
+        Text->SubmitLabel(*Queue, PlayerPositionLabel, Player->Position.x+5.0f, Player->Position.y-20.0f, 0.4f);
+        Text->SubmitLabel(*Queue, PlayerVelocityLabel, Player->Position.x+5.0f, Player->Position.y-10.0f, 0.4f);
+        Text->SubmitLabel(*Queue, BallPositionLabel, Ball->Position.x+35.0f, Ball->Position.y+5.0f, 0.4f);
+        Text->SubmitLabel(*Queue, BallVelocityLabel, Ball->Position.x+35.0f, Ball->Position.y+15.0f, 0.4f);
+
+        // brick labels never change for a level, so their glyph runs are laid out only once
+        std::vector<GameObject> &bricks = this->ActiveLevel.Bricks;
+        for (unsigned int i = visibleBegin; i < visibleEnd; ++i)
         {
+            GameObject &box = bricks[i];
             if(!box.Destroyed)
             {
-                std::stringstream brickX; brickX << round(box.Position.x);
-                std::stringstream brickY; brickY << box.Position.y;
-                Text->RenderText("X:" + brickX.str(), box.Position.x+12.0f, box.Position.y+10.0f, 0.40f);
-                Text->RenderText("Y:" + brickY.str(), box.Position.x+12.0f, box.Position.y+20.0f, 0.40f);
+                float y = box.Position.y - CameraY;
+                BrickLabels[2 * i].Format("X:", std::round(box.Position.x));
+                BrickLabels[2 * i + 1].Format("Y:", box.Position.y);
+                Text->SubmitLabel(*Queue, BrickLabels[2 * i], box.Position.x+12.0f, y+10.0f, 0.40f);
+                Text->SubmitLabel(*Queue, BrickLabels[2 * i + 1], box.Position.x+12.0f, y+20.0f, 0.40f);
             }
         }
     }
+
+    // CPU-side vertex data is filled on the workers, the main thread only issues the draws
+    Particles->BuildInstances(Pool);
+    Text->BuildVertices(Pool);
+
+    Queue->Execute();
+    Stream->EndFrame();
 }
 
 void Game::DoCollisions()
 {
-    for (GameObject &box : this->Levels[this->Level].Bricks)
+    // bricks are tested in level space and only those of the chunks the ball overlaps; the ball 
+    // moves there for the tests, the collision responses only shift it
+    std::vector<GameObject> &bricks = this->ActiveLevel.Bricks;
+    unsigned int begin, end;
+    this->ActiveLevel.BricksIn(Ball->Position.y + CameraY, Ball->Position.y + CameraY + Ball->Size.y, begin, end);
+    Ball->Position.y += CameraY;
+    for (unsigned int i = begin; i < end; ++i)
     {
+        GameObject &box = bricks[i];
         if (!box.Destroyed)
         {
             Collision collision = CheckCollision(*Ball, box);
@@ -359,7 +603,8 @@ void Game::DoCollisions()
             {
                 if (!box.IsSolid)
                 {
-                    box.Destroyed = true;
+                    this->ActiveLevel.Destroy(i);
+                    BrickBatch->SetAlive(i, false);
                     this->SpawnPowerUps(box);
                 }
 
@@ -386,6 +631,7 @@ void Game::DoCollisions()
             }
         }
     }
+    Ball->Position.y -= CameraY;
     Collision result = CheckCollision(*Ball, *Player);
     if (!Ball->Stuck && std::get<0>(result))
     {
@@ -447,22 +693,30 @@ void Game::PaddleCollision()
     Ball->Stuck = Ball->Sticky;
 }
 
+void Game::SetAntialiasing(unsigned int samples, bool fxaa)
+{
+    Effects->SetSamples(samples);
+    Effects->FXAA = fxaa;
+    this->Samples = Effects->Samples;
+    this->FXAA = fxaa;
+}
+
 void Game::ResetLevel()
 {   
     this->ResetPlayer();
     Ball->Stuck = true;
     this->Lives = 3;
     this->State = GAME_MENU;
-    if (this->Level == 0)
-        this->Levels[0].Load("levels/one.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 1)
-        this->Levels[1].Load("levels/two.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 2)
-        this->Levels[2].Load("levels/three.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 3)
-        this->Levels[3].Load("levels/four.lvl", this->Width, this->Height / 2);
-    else if (this->Level == 4)
-        this->Levels[3].Load("levels/five.lvl", this->Width, this->Height / 2);
+    // the level was parsed when it was selected (or hot reloaded), a reset only restores the bricks
+    this->ActiveLevel.Reset();
+    CameraY = this->CameraTarget();
+    this->UploadBricks();
+}
+
+void Game::UploadBricks()
+{
+    BrickBatch->Load(this->ActiveLevel.Bricks, Pool);
+    BrickLabels.assign(this->ActiveLevel.Bricks.size() * 2, TextLabel());
 }
 
 void Game::ResetPlayer()
@@ -479,26 +733,36 @@ void Game::ResetPlayer()
 
 void Game::SpawnPowerUps(GameObject &block)
 {
+    // resolved on the first spawn, every later one only indexes the texture table. Power-up textures 
+    // are only resident while a power-up uses them (or the budget leaves room)
+    static const TextureID speed = ResourceManager::FindTexture("powerup_speed");
+    static const TextureID sticky = ResourceManager::FindTexture("powerup_sticky");
+    static const TextureID passThrough = ResourceManager::FindTexture("powerup_passthrough");
+    static const TextureID increase = ResourceManager::FindTexture("powerup_increase");
+    static const TextureID confuse = ResourceManager::FindTexture("powerup_confuse");
+    static const TextureID chaos = ResourceManager::FindTexture("powerup_chaos");
+    // power-ups fall in screen space from where the brick is shown
+    glm::vec2 position = block.Position - glm::vec2(0.0f, CameraY);
     //Positives
     if (ShouldSpawn(75))
         this->PowerUps.push_back(PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, 
-                                        block.Position, ResourceManager::GetTexture("powerup_speed")));
+                                        position, speed));
     if (ShouldSpawn(75))
         this->PowerUps.push_back(PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, 
-                                        block.Position, ResourceManager::GetTexture("powerup_sticky")));
+                                        position, sticky));
     if (ShouldSpawn(75))
         this->PowerUps.push_back(PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, 
-                                        block.Position, ResourceManager::GetTexture("powerup_passthrough")));
+                                        position, passThrough));
     if (ShouldSpawn(75))
         this->PowerUps.push_back(PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, 
-                                        block.Position, ResourceManager::GetTexture("powerup_increase")));
+                                        position, increase));
     //Negatives
     if (ShouldSpawn(15)) 
         this->PowerUps.push_back(PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, 
-                                        block.Position, ResourceManager::GetTexture("powerup_confuse")));
+                                        position, confuse));
     if (ShouldSpawn(15))
         this->PowerUps.push_back(PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, 
-                                        block.Position, ResourceManager::GetTexture("powerup_chaos")));
+                                        position, chaos));
 }  
 
 void Game::UpdatePowerUps(float dt)
@@ -548,7 +812,9 @@ void Game::UpdatePowerUps(float dt)
             }
         }
     }
-    this->PowerUps.erase(std::remove_if(this->PowerUps.begin(), this->PowerUps.end(),
-        [](const PowerUp &powerUp) { return powerUp.Destroyed && !powerUp.Activated; }
-    ), this->PowerUps.end());
+    auto expired = [](const PowerUp &powerUp) { return powerUp.Destroyed && !powerUp.Activated; };
+    for (const PowerUp &powerUp : this->PowerUps)
+        if (expired(powerUp))
+            ResourceManager::ReleaseTexture(powerUp.Skin);
+    this->PowerUps.erase(std::remove_if(this->PowerUps.begin(), this->PowerUps.end(), expired), this->PowerUps.end());
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include "colision.h"
 #include "power_up.h"
 
+struct AssetChange;
+
 // Represents the current state of the game
 enum GameState {
     GAME_ACTIVE,
@@ -35,10 +37,20 @@ public:
     double yPos;
     float PaddleVelocity = 0;
     unsigned int Width, Height;
-    std::vector<GameLevel> Levels;
+    // the selected level of the manifest in levels/, built from the level cache
+    GameLevel ActiveLevel;
     unsigned int Level;
     unsigned int Lives = 3;
     std::vector<PowerUp>  PowerUps;
+    // worker threads used to build vertex data, 0 builds everything on the main thread
+    unsigned int WorkerThreads;
+    // MSAA samples of the scene buffer (0, 2, 4 or 8) and whether the FXAA pass runs
+    unsigned int Samples;
+    bool FXAA;
+    // watches shaders/, textures/ and levels/ and swaps changed files in while running
+    bool HotReload;
+    // bricks keep a fixed height and levels taller than the screen scroll as they are cleared
+    bool Scrolling;
 
     Game(unsigned int width, unsigned int height);
     ~Game();
@@ -49,6 +61,12 @@ public:
     void LoadShaders();
     void LoadTextures();
     void LoadLevels();
+    // lays the tiles out as the active level, squeezed into the top half or scrolling
+    void BuildLevel(TileView tiles);
+    // level space y the camera settles at, above the lowest bricks left
+    float CameraTarget();
+    // builds the level and prefetches its neighbours in the menu order; the bricks still need an UploadBricks
+    void SelectLevel(unsigned int level);
 
     void ConfigureGameObjects();
     
@@ -63,7 +81,15 @@ public:
     void VerticalCollision(Direction dir, glm::vec2 diff_vector);
     void PaddleCollision();
     
+    // applies an antialiasing setting, the sample count is clamped to what the driver supports
+    void SetAntialiasing(unsigned int samples, bool fxaa);
+
+    // swaps in hot reloaded assets that are ready, spending at most HOT_RELOAD_BUDGET_MS; call once per frame
+    void ApplyReloads();
+    void ReloadAsset(AssetChange &change);
+
     void ResetLevel();
+    void UploadBricks();
     void ResetPlayer();
 
     void SpawnPowerUps(GameObject &block);
@@ -1,100 +1,212 @@
 #include "game_level.h"
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#include <sys/stat.h>
 
 
 void GameLevel::Load(const char *file, unsigned int levelWidth, unsigned int levelHeight)
 {
-    // clear old data
-    this->Bricks.clear();
-   
-    // load from file
-    unsigned int tileCode;
-    GameLevel level;
-    std::string line;
-    std::ifstream fstream(file);
-    std::vector<std::vector<unsigned int>> tileData;
-    if (fstream)
+    this->File = file;
+
+    if (const PackEntry *entry = ResourceManager::Pack.Find(file, PACK_LEVEL))
+        // compiled levels are already a rectangular grid, built straight from the mapping
+        this->Build({ packedTiles(*entry), entry->Width, entry->Height }, levelWidth, levelHeight);
+    else
+        this->Build(ReadLevel(file).View(), levelWidth, levelHeight);
+}
+
+LevelTiles GameLevel::ReadLevel(const char *file)
+{
+    if (const PackEntry *entry = ResourceManager::Pack.Find(file, PACK_LEVEL))
     {
-        while (std::getline(fstream, line)) 
-        {
-            std::istringstream sstream(line);
-            std::vector<unsigned int> row;
-            while (sstream >> tileCode)
-                row.push_back(tileCode);
-            tileData.push_back(row);
-        }
-        if (tileData.size() > 0)
-            this->init(tileData, levelWidth, levelHeight);
+        const unsigned int *codes = packedTiles(*entry);
+        return { entry->Width, entry->Height, std::vector<unsigned int>(codes, codes + entry->Width * entry->Height) };
     }
+    // the level compiled by lvlc, unless the text was edited after it
+    std::string compiled = CompiledLevelPath(file);
+    struct stat textInfo, compiledInfo;
+    bool useCompiled = stat(compiled.c_str(), &compiledInfo) == 0 
+        && (stat(file, &textInfo) != 0 || compiledInfo.st_mtime >= textInfo.st_mtime);
+    return ReadTiles(useCompiled ? compiled.c_str() : file);
+}
+
+const unsigned int *GameLevel::packedTiles(const PackEntry &entry)
+{
+    static_assert(sizeof(unsigned int) == sizeof(uint32_t), "packed tile codes are 32 bit");
+    return reinterpret_cast<const unsigned int*>(ResourceManager::Pack.Data(entry));
 }
 
-void GameLevel::Draw(SpriteRenderer &renderer)
+void GameLevel::Build(TileView tiles, unsigned int levelWidth, unsigned int levelHeight)
 {
-    for (GameObject &tile : this->Bricks)
-        if (!tile.Destroyed)
-            tile.Draw(renderer);
+    // the rows share the level height in whole pixels
+    this->layout(tiles, tiles.Width > 0 ? levelWidth / static_cast<float>(tiles.Width) : 0.0f, 
+                    tiles.Height > 0 ? levelHeight / tiles.Height : 0.0f);
+}
+
+void GameLevel::BuildScrolling(TileView tiles, unsigned int levelWidth, float rowHeight)
+{
+    this->layout(tiles, tiles.Width > 0 ? levelWidth / static_cast<float>(tiles.Width) : 0.0f, rowHeight);
+}
+
+void GameLevel::layout(TileView tiles, float unit_width, float unit_height)
+{
+    this->Bricks.clear();
+    this->Chunks.clear();
+    this->Height = this->chunkHeight = 0.0f;
+    this->remaining = this->breakable = 0;
+    if (tiles.Width > 0 && tiles.Height > 0)
+        this->init(tiles, unit_width, unit_height);
+    this->initial = this->Bricks;
+    this->initialChunks = this->Chunks;
+}
+
+void GameLevel::Reset()
+{
+    this->Bricks = this->initial;
+    this->Chunks = this->initialChunks;
+    this->remaining = this->breakable;
+}
+
+LevelTiles GameLevel::ReadTiles(const char *file)
+{
+    LevelTiles tiles;
+    LevelParseError error;
+    if (!ReadLevelFile(file, tiles, error))
+    {
+        std::cout << "ERROR::LEVEL: " << file;
+        if (error.Line > 0)
+            std::cout << ":" << error.Line << ":" << error.Column;
+        std::cout << ": " << error.Message << std::endl;
+        tiles = { 0, 0, {} };
+    }
+    return tiles;
 }
 
 bool GameLevel::IsCompleted()
 {
-    for (GameObject &tile : this->Bricks)
-        if (!tile.IsSolid && !tile.Destroyed)
-            return false;
-    return true;
+    return this->remaining == 0;
+}
+
+void GameLevel::Destroy(unsigned int index)
+{
+    GameObject &brick = this->Bricks[index];
+    if (brick.Destroyed || brick.IsSolid)
+        return;
+    brick.Destroyed = true;
+    --this->remaining;
+    // the last chunk starting at or before the brick
+    auto chunk = std::upper_bound(this->Chunks.begin(), this->Chunks.end(), index, 
+                                    [](unsigned int index, const LevelChunk &chunk) { return index < chunk.Begin; });
+    --(chunk - 1)->Remaining;
+}
+
+unsigned int GameLevel::BricksDestroyed() const
+{
+    return this->breakable - this->remaining;
+}
+
+void GameLevel::BricksIn(float top, float bottom, unsigned int &begin, unsigned int &end) const
+{
+    begin = end = 0;
+    if (this->Chunks.empty() || bottom <= 0.0f || top >= this->Height)
+        return;
+    // rows squeezed below a pixel can't be told apart, every chunk may overlap
+    unsigned int first = 0, last = this->Chunks.size() - 1;
+    if (this->chunkHeight > 0.0f)
+    {
+        first = std::min<size_t>(static_cast<size_t>(std::max(top, 0.0f) / this->chunkHeight), last);
+        last = std::min<size_t>(static_cast<size_t>(bottom / this->chunkHeight), last);
+    }
+    begin = this->Chunks[first].Begin;
+    end = this->Chunks[last].End;
+}
+
+float GameLevel::LowestRemaining() const
+{
+    for (auto chunk = this->Chunks.rbegin(); chunk != this->Chunks.rend(); ++chunk)
+    {
+        if (chunk->Remaining == 0)
+            continue;
+        float lowest = 0.0f;
+        for (unsigned int i = chunk->Begin; i < chunk->End; ++i)
+        {
+            const GameObject &brick = this->Bricks[i];
+            if (!brick.IsSolid && !brick.Destroyed)
+                lowest = std::max(lowest, brick.Position.y + brick.Size.y);
+        }
+        return lowest;
+    }
+    return 0.0f;
 }
 
 void GameLevel::CheckBlockType(float unit_width, float unit_height, unsigned int x, unsigned int y)
 {
     glm::vec2 pos(unit_width * x, unit_height * y);
     glm::vec2 size(unit_width, unit_height);
-    GameObject obj(pos, size, ResourceManager::GetTexture("brick_solid"), glm::vec3(0.8f, 0.8f, 0.7f));
+    static const TextureID solid = ResourceManager::FindTexture("brick_solid");
+    GameObject &obj = this->Bricks.emplace_back(pos, size, ResourceManager::GetTexture(solid), glm::vec3(0.8f, 0.8f, 0.7f));
     obj.IsSolid = true;
-    this->Bricks.push_back(obj);
 }
 
-void GameLevel::BlockColoring(std::vector<std::vector<unsigned int>> tileData, float unit_width, 
-                                float unit_height, unsigned int x, unsigned int y)
+void GameLevel::BlockColoring(unsigned int tileCode, float unit_width, float unit_height, unsigned int x, unsigned int y)
 {
     glm::vec3 color = glm::vec3(1.0f); // original: white
-    if (tileData[y][x] == 2)
+    if (tileCode == 2)
         color = glm::vec3(0.11f, 0.2f, 0.804f);// dark blue 
-    else if (tileData[y][x] == 3)
+    else if (tileCode == 3)
         color = glm::vec3(0.2f, 0.649f, 0.9f); // light blue
-    else if (tileData[y][x] == 4)
+    else if (tileCode == 4)
         color = glm::vec3(0.581f, 0.169f, 0.827f); // purple
-    else if (tileData[y][x] == 5)
+    else if (tileCode == 5)
         color = glm::vec3(0.350f, 0.0f, 0.610f); // dark purple
     glm::vec2 pos(unit_width * x, unit_height * y);
     glm::vec2 size(unit_width, unit_height);
-    this->Bricks.push_back(GameObject(pos, size, ResourceManager::GetTexture("brick"), color));
+    static const TextureID brick = ResourceManager::FindTexture("brick");
+    this->Bricks.emplace_back(pos, size, ResourceManager::GetTexture(brick), color);
 }
 
-void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight)
+void GameLevel::init(TileView tiles, float unit_width, float unit_height)
 {
     //dimensions
-    unsigned int width = tileData[0].size(); //we can index vector at [0], function only called if height > 0
-    unsigned int height = tileData.size();
-    float unit_width = levelWidth / static_cast<float>(width);
-    float unit_height = levelHeight / height; 
+    unsigned int width = tiles.Width;
+    unsigned int height = tiles.Height;
+    this->Height = unit_height * height;
+    this->chunkHeight = unit_height * LEVEL_CHUNK_ROWS;
+
+    // one allocation for every brick
+    const unsigned int *end = tiles.Codes + static_cast<size_t>(width) * height;
+    this->Bricks.reserve(end - tiles.Codes - std::count(tiles.Codes, end, 0u));
+    this->Chunks.reserve((height + LEVEL_CHUNK_ROWS - 1) / LEVEL_CHUNK_ROWS);
    
     // initialize tiles using tileData		
     for (unsigned int y = 0; y < height; ++y)
     {
+        if (y % LEVEL_CHUNK_ROWS == 0)
+        {
+            if (!this->Chunks.empty())
+                this->Chunks.back().End = this->Bricks.size();
+            this->Chunks.push_back({ static_cast<unsigned int>(this->Bricks.size()), 0, 0 });
+        }
+        const unsigned int *row = tiles.Codes + static_cast<size_t>(y) * width;
         for (unsigned int x = 0; x < width; ++x)
         {
             // check block type from level data (2D level array)
-            if (tileData[y][x] == 1) // solid
+            if (row[x] == 1) // solid
             {
                this->CheckBlockType(unit_width, unit_height, x, y);
             }
 
-            else if (tileData[y][x] > 1)// non-solid, determine its color based on level data
+            else if (row[x] > 1)// non-solid, determine its color based on level data
             {
-                this->BlockColoring(tileData, unit_width, unit_height, x, y);
+                this->BlockColoring(row[x], unit_width, unit_height, x, y);
+                ++this->Chunks.back().Remaining;
             }
         }
     }
+    this->Chunks.back().End = this->Bricks.size();
+    this->breakable = this->remaining = this->Bricks.size() - std::count_if(this->Bricks.begin(), this->Bricks.end(), 
+                                                                            [](const GameObject &brick) { return brick.IsSolid; });
 }
-
@@ -1,5 +1,7 @@
 #ifndef GAMELEVEL_H
 #define GAMELEVEL_H
+#include <string>
+#include <type_traits>
 #include <vector>
 
 #include <glad/glad.h>
@@ -8,28 +10,73 @@
 #include "game_object.h"
 #include "sprite_renderer.h"
 #include "resource_manager.h"
+#include "level_parser.h"
+
+static_assert(std::is_trivially_copyable<GameObject>::value, "level resets copy bricks as plain data");
+
+// rows of bricks stored together, the unit rendering and collisions cull by
+const unsigned int LEVEL_CHUNK_ROWS = 8;
+
+struct LevelChunk {
+    unsigned int Begin, End;    // range of the level's Bricks
+    unsigned int Remaining;     // breakable bricks not destroyed yet
+};
 
 class GameLevel
 {
 public:
-    // State
+    // State, bricks ordered by row so every chunk is a contiguous range of them
     std::vector<GameObject> Bricks;
+    std::vector<LevelChunk> Chunks;
+    // file the level was loaded from
+    std::string File;
+    // laid out height of all rows
+    float Height;
     
-    GameLevel() { }
+    GameLevel() : Height(0.0f), chunkHeight(0.0f), remaining(0), breakable(0) { }
 
+    // uses the compiled level of the asset pack when it holds the file, else the one lvlc wrote next 
+    // to it when that is up to date
     void Load(const char *file, unsigned int levelWidth, unsigned int levelHeight);
-   
-    void Draw(SpriteRenderer &renderer);
+    // replaces the bricks with already parsed tiles, e.g. of a cached or hot reloaded level
+    void Build(TileView tiles, unsigned int levelWidth, unsigned int levelHeight);
+    // lays the rows out rowHeight apart instead, however many there are, for levels taller than the screen
+    void BuildScrolling(TileView tiles, unsigned int levelWidth, float rowHeight);
+
+    // restores every brick of the layout as it was loaded, a copy of plain data without touching the file
+    void Reset();
+
+    // the tiles Load builds from, without building; safe on any thread
+    static LevelTiles ReadLevel(const char *file);
+    // reads a text or compiled level, see ReadLevelFile; reports where it failed and returns 0x0 
+    // if the file can't be read or parsed
+    static LevelTiles ReadTiles(const char *file);
    
     bool IsCompleted();
+    // destroys a breakable brick, keeping the counts of its chunk
+    void Destroy(unsigned int index);
+    unsigned int BricksDestroyed() const;
+    // the bricks of every chunk overlapping the band [top, bottom) of the level, as a range of Bricks
+    void BricksIn(float top, float bottom, unsigned int &begin, unsigned int &end) const;
+    // the bottom edge of the lowest breakable brick left, 0 once none is
+    float LowestRemaining() const;
 
 private:
+    float chunkHeight;
+    unsigned int remaining, breakable;
+    // bricks and chunks as parsed, left untouched by play so resets only copy them back
+    std::vector<GameObject> initial;
+    std::vector<LevelChunk> initialChunks;
+
+    // tile codes of a level in the asset pack mapping
+    static const unsigned int *packedTiles(const PackEntry &entry);
+
+    // rebuilds bricks and chunks with the given tile size
+    void layout(TileView tiles, float unit_width, float unit_height);
     // initialize from tile data
-    void init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, 
-                unsigned int levelHeight);
+    void init(TileView tiles, float unit_width, float unit_height);
     void CheckBlockType(float unit_width, float unit_height, unsigned int x, unsigned int y);
-    void BlockColoring(std::vector<std::vector<unsigned int>> tileData, 
-                        float unit_width, float unit_height, unsigned int x, unsigned int y);
+    void BlockColoring(unsigned int tileCode, float unit_width, float unit_height, unsigned int x, unsigned int y);
 };
 
 #endif
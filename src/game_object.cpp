@@ -15,3 +15,8 @@ void GameObject::Draw(SpriteRenderer &renderer)
     renderer.DrawSprite(this->Sprite, this->Position, this->Size, this->Rotation, this->Color);
 }
 
+void GameObject::Submit(SpriteRenderer &renderer, RenderQueue &queue, RenderLayer layer)
+{
+    renderer.SubmitSprite(queue, layer, this->Sprite, this->Position, this->Size, this->Rotation, this->Color);
+}
+
@@ -6,8 +6,9 @@
 
 #include "texture.h"
 #include "sprite_renderer.h"
+#include "render_queue.h"
 
-// Minimal of state, most objects use this.
+// Minimal of state, most objects use this. Plain data without a vtable, bricks are stored by value.
 class GameObject
 {
 public:
@@ -25,9 +26,11 @@ public:
     GameObject();
     GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, 
                 glm::vec3 color = glm::vec3(1.0f), glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
-    virtual ~GameObject() = default;
 
-    virtual void Draw(SpriteRenderer &renderer);
+    void Draw(SpriteRenderer &renderer);
+
+    // queues the object's sprite on the given layer
+    void Submit(SpriteRenderer &renderer, RenderQueue &queue, RenderLayer layer);
 };
 
 #endif
@@ -0,0 +1,38 @@
+#include "gl_extensions.h"
+
+#include <GLFW/glfw3.h>
+
+bool                            GLExtensions::ParallelShaderCompile = false;
+PFNMAXSHADERCOMPILERTHREADSPROC GLExtensions::MaxShaderCompilerThreads = nullptr;
+bool                            GLExtensions::ProgramBinary = false;
+PFNGETPROGRAMBINARYPROC         GLExtensions::GetProgramBinary = nullptr;
+PFNPROGRAMBINARYPROC            GLExtensions::LoadProgramBinary = nullptr;
+PFNPROGRAMPARAMETERIPROC        GLExtensions::ProgramParameteri = nullptr;
+bool                            GLExtensions::TextureCompressionS3TC = false;
+
+
+void GLExtensions::Load()
+{
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+        MaxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+        MaxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    ParallelShaderCompile = MaxShaderCompilerThreads != nullptr;
+    // let the driver pick how many threads compile in the background
+    if (ParallelShaderCompile)
+        MaxShaderCompilerThreads(0xFFFFFFFF);
+
+    if (glfwExtensionSupported("GL_ARB_get_program_binary"))
+    {
+        GetProgramBinary = (PFNGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+        LoadProgramBinary = (PFNPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+        ProgramParameteri = (PFNPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+    }
+    // drivers may expose the entry points without supporting a single binary format
+    GLint formats = 0;
+    if (GetProgramBinary && LoadProgramBinary && ProgramParameteri)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    ProgramBinary = formats > 0;
+
+    TextureCompressionS3TC = glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+}
@@ -0,0 +1,54 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// the glad loader only covers core 3.3, optional extensions are looked up here at runtime
+
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+// ARB_get_program_binary (core in 4.1)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+typedef void (APIENTRYP PFNGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, 
+                                                    GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+// EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+class GLExtensions
+{
+public:
+    // compiling and linking return immediately, GL_COMPLETION_STATUS_KHR tells when they are done
+    static bool ParallelShaderCompile;
+    static PFNMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads;
+
+    // linked programs can be saved and restored as driver specific binaries
+    static bool ProgramBinary;
+    static PFNGETPROGRAMBINARYPROC GetProgramBinary;
+    static PFNPROGRAMBINARYPROC LoadProgramBinary;
+    static PFNPROGRAMPARAMETERIPROC ProgramParameteri;
+
+    // BC1/BC3 textures can be uploaded as they are, otherwise they are decoded on the CPU
+    static bool TextureCompressionS3TC;
+
+    // queries the current context, call once after glad is loaded
+    static void Load();
+private:
+    GLExtensions() { }
+};
+
+#endif
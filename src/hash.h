@@ -0,0 +1,19 @@
+#ifndef HASH_H
+#define HASH_H
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a, chain calls by passing the previous result as seed
+inline uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ull)
+{
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+#endif
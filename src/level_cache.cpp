@@ -0,0 +1,162 @@
+#include "level_cache.h"
+#include "game_level.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+
+LevelCache::LevelCache(unsigned int capacity)
+    : capacity(std::max(capacity, 3u)), useTick(0), loading(-1), stopping(false)
+{
+    this->loader = std::thread(&LevelCache::loaderLoop, this);
+}
+
+LevelCache::~LevelCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    this->loader.join();
+}
+
+unsigned int LevelCache::LoadManifest(const std::string &directory, const std::string &manifest)
+{
+    this->files.clear();
+    std::ifstream stream(directory + "/" + manifest);
+    if (stream)
+    {
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            line = line.substr(0, line.find('#'));
+            size_t begin = line.find_first_not_of(" \t\r"), end = line.find_last_not_of(" \t\r");
+            if (begin != std::string::npos)
+                this->files.push_back(directory + "/" + line.substr(begin, end - begin + 1));
+        }
+        return this->files.size();
+    }
+
+    // text levels, and compiled ones shipped without their text under the name of the text
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string extension = entry.path().extension().string();
+        std::string file = directory + "/" + entry.path().stem().string() + ".lvl";
+        if (entry.is_regular_file() && (extension == ".lvl" || extension == ".lvlc") 
+            && std::find(this->files.begin(), this->files.end(), file) == this->files.end())
+            this->files.push_back(file);
+    }
+    std::sort(this->files.begin(), this->files.end());
+    return this->files.size();
+}
+
+unsigned int LevelCache::Count() const
+{
+    return this->files.size();
+}
+
+const std::string &LevelCache::File(unsigned int index) const
+{
+    return this->files[index];
+}
+
+std::shared_ptr<const LevelTiles> LevelCache::Get(unsigned int index)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    // a prefetch in progress is done sooner than reading the level again
+    this->loaded.wait(lock, [this, index]() { return this->loading != static_cast<int>(index); });
+    auto iter = this->entries.find(index);
+    if (iter != this->entries.end())
+    {
+        iter->second.LastUse = ++this->useTick;
+        return iter->second.Tiles;
+    }
+    // read it here rather than behind the prefetches queued before it
+    this->queue.erase(std::remove(this->queue.begin(), this->queue.end(), index), this->queue.end());
+    uint64_t generation = this->generations[index];
+    lock.unlock();
+    std::shared_ptr<const LevelTiles> tiles = std::make_shared<const LevelTiles>(GameLevel::ReadLevel(this->files[index].c_str()));
+    lock.lock();
+    // a Store while it was read holds the newer tiles, and stays pinned in the cache
+    iter = this->entries.find(index);
+    if (this->generations[index] != generation && iter != this->entries.end())
+    {
+        iter->second.LastUse = ++this->useTick;
+        return iter->second.Tiles;
+    }
+    if (this->generations[index] == generation)
+        this->insert(index, tiles);
+    return tiles;
+}
+
+void LevelCache::Prefetch(unsigned int index)
+{
+    if (index >= this->files.size())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->entries.count(index) || this->loading == static_cast<int>(index) 
+            || std::find(this->queue.begin(), this->queue.end(), index) != this->queue.end())
+            return;
+        this->queue.push_back(index);
+    }
+    this->wake.notify_one();
+}
+
+void LevelCache::Store(const std::string &file, const LevelTiles &tiles)
+{
+    std::shared_ptr<const LevelTiles> stored = std::make_shared<const LevelTiles>(tiles);
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (unsigned int i = 0; i < this->files.size(); ++i)
+        if (this->files[i] == file)
+        {
+            this->generations[i]++;
+            this->insert(i, stored, true);
+        }
+}
+
+void LevelCache::loaderLoop()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true)
+    {
+        this->wake.wait(lock, [this]() { return this->stopping || !this->queue.empty(); });
+        if (this->stopping)
+            return;
+        unsigned int index = this->queue.front();
+        this->queue.pop_front();
+        // stored while it waited in the queue
+        if (this->entries.count(index))
+            continue;
+        this->loading = index;
+        uint64_t generation = this->generations[index];
+        lock.unlock();
+        std::shared_ptr<const LevelTiles> tiles = std::make_shared<const LevelTiles>(GameLevel::ReadLevel(this->files[index].c_str()));
+        lock.lock();
+        // read from the file as it was before a hot reload stored newer tiles
+        if (this->generations[index] == generation)
+            this->insert(index, tiles);
+        this->loading = -1;
+        this->loaded.notify_all();
+    }
+}
+
+void LevelCache::insert(unsigned int index, std::shared_ptr<const LevelTiles> tiles, bool pinned)
+{
+    this->entries[index] = { tiles, ++this->useTick, pinned };
+    while (this->entries.size() > this->capacity)
+    {
+        auto oldest = this->entries.end();
+        for (auto iter = this->entries.begin(); iter != this->entries.end(); ++iter)
+            if (!iter->second.Pinned && (oldest == this->entries.end() || iter->second.LastUse < oldest->second.LastUse))
+                oldest = iter;
+        // only hot reloaded levels are left
+        if (oldest == this->entries.end())
+            break;
+        this->entries.erase(oldest);
+    }
+}
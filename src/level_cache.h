@@ -0,0 +1,64 @@
+#ifndef LEVEL_CACHE_H
+#define LEVEL_CACHE_H
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "level_parser.h"
+
+// The level files of a manifest and the parsed tiles of the recently used ones. A level is read
+// when it is first requested, or ahead of time by Prefetch on the cache's own loader thread, and
+// only the Capacity most recently used levels stay cached.
+class LevelCache
+{
+public:
+    // keeps at least 3 levels, the selected one and both neighbours
+    LevelCache(unsigned int capacity);
+    ~LevelCache();
+
+    // reads the manifest in the directory, one level file per line relative to the directory and
+    // '#' starting a comment; without one lists the directory's levels by name. Returns the count
+    unsigned int LoadManifest(const std::string &directory, const std::string &manifest = "levels.txt");
+    unsigned int Count() const;
+    // e.g. "levels/one.lvl", which may only exist compiled
+    const std::string &File(unsigned int index) const;
+
+    // the tiles of the level, waiting for a prefetch in progress or reading it on the spot on a miss
+    std::shared_ptr<const LevelTiles> Get(unsigned int index);
+    // queues the level for the loader thread unless it is cached or on its way
+    void Prefetch(unsigned int index);
+    // replaces the tiles of every level read from the file, e.g. after it was hot reloaded; they 
+    // are never evicted, reading the level again could return the old version from the asset pack
+    void Store(const std::string &file, const LevelTiles &tiles);
+private:
+    struct Entry {
+        std::shared_ptr<const LevelTiles> Tiles;
+        uint64_t LastUse;
+        bool Pinned;        // stored rather than read, see Store
+    };
+    std::vector<std::string> files;
+    unsigned int capacity;
+    // the mutex guards everything below
+    std::mutex mutex;
+    std::unordered_map<unsigned int, Entry> entries;
+    // bumped by every Store of a level, a read that started before it is stale and dropped
+    std::unordered_map<unsigned int, uint64_t> generations;
+    uint64_t useTick;
+    std::deque<unsigned int> queue;
+    int loading;                    // index the loader thread is reading, -1 when idle
+    bool stopping;
+    std::condition_variable wake, loaded;
+    std::thread loader;
+
+    void loaderLoop();
+    // caches the tiles and evicts the least recently used unpinned levels over capacity; mutex held
+    void insert(unsigned int index, std::shared_ptr<const LevelTiles> tiles, bool pinned = false);
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "level_parser.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// tile codes are small, anything longer is a typo rather than a brick
+static const unsigned int MAX_TILE_CODE = 1u << 24;
+
+
+static bool fail(LevelParseError &error, const std::string &message, unsigned int line, unsigned int column)
+{
+    error = { message, line, column };
+    return false;
+}
+
+bool ParseLevel(const char *text, size_t size, LevelTiles &tiles, LevelParseError &error)
+{
+    tiles = { 0, 0, {} };
+    // "1 2 3" spends two bytes per tile, reserving for that avoids regrowing on large levels
+    tiles.Codes.reserve(size / 2 + 1);
+
+    const char *pos = text, *end = text + size, *lineStart = text;
+    unsigned int line = 1, rowWidth = 0, blankRows = 0;
+    size_t rowStart = 0;
+    // closes the row of the current line; rows are never longer than the first, that is checked per tile
+    auto endRow = [&]() {
+        if (rowWidth == 0)
+        {
+            ++blankRows;
+            return;
+        }
+        if (tiles.Height == 0)
+            tiles.Width = rowWidth;
+        if (rowWidth < tiles.Width)
+            tiles.Codes.resize(rowStart + tiles.Width, 0);
+        if (blankRows > 0)
+        {
+            tiles.Codes.insert(tiles.Codes.begin() + rowStart, static_cast<size_t>(blankRows) * tiles.Width, 0);
+            tiles.Height += blankRows;
+            blankRows = 0;
+        }
+        ++tiles.Height;
+        rowStart = tiles.Codes.size();
+        rowWidth = 0;
+    };
+
+    while (pos < end)
+    {
+        char c = *pos;
+        if (c >= '0' && c <= '9')
+        {
+            const char *tokenStart = pos;
+            unsigned int code = 0;
+            do
+            {
+                code = code * 10 + static_cast<unsigned int>(*pos - '0');
+                if (code > MAX_TILE_CODE)
+                    return fail(error, "tile code too large", line, tokenStart - lineStart + 1);
+            }
+            while (++pos < end && *pos >= '0' && *pos <= '9');
+            if (tiles.Height > 0 && rowWidth == tiles.Width)
+                return fail(error, "row has more tiles than the first row (" + std::to_string(tiles.Width) + ")",
+                            line, tokenStart - lineStart + 1);
+            tiles.Codes.push_back(code);
+            ++rowWidth;
+            // a code has to end at whitespace, "12x" isn't two tokens
+            if (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n' && *pos != '\v' && *pos != '\f')
+                return fail(error, std::string("unexpected character '") + *pos + "' after a tile code",
+                            line, pos - lineStart + 1);
+        }
+        else if (c == '\n')
+        {
+            endRow();
+            ++pos;
+            ++line;
+            lineStart = pos;
+        }
+        // stray tabs, trailing spaces and CRLF line endings are only separators
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f')
+            ++pos;
+        else if (static_cast<unsigned char>(c) >= 0x20 && static_cast<unsigned char>(c) < 0x7f)
+            return fail(error, std::string("unexpected character '") + c + "'", line, pos - lineStart + 1);
+        else
+        {
+            char hex[8];
+            std::snprintf(hex, sizeof(hex), "0x%02x", static_cast<unsigned char>(c));
+            return fail(error, std::string("unexpected byte ") + hex, line, pos - lineStart + 1);
+        }
+    }
+    // the last line doesn't need a newline
+    endRow();
+    if (tiles.Height == 0)
+        return fail(error, "level has no tiles", line, 1);
+    return true;
+}
+
+bool IsCompiledLevel(const void *data, size_t size)
+{
+    return size >= sizeof(LevelFileHeader) && std::memcmp(data, "BKLV", 4) == 0;
+}
+
+std::vector<unsigned char> CompileLevel(TileView tiles)
+{
+    std::vector<uint32_t> palette;
+    size_t count = static_cast<size_t>(tiles.Width) * tiles.Height;
+    for (size_t i = 0; i < count; ++i)
+        if (std::find(palette.begin(), palette.end(), tiles.Codes[i]) == palette.end())
+        {
+            if (palette.size() == 256)
+                return {};
+            palette.push_back(tiles.Codes[i]);
+        }
+    std::sort(palette.begin(), palette.end());
+
+    LevelFileHeader header = { { 'B', 'K', 'L', 'V' }, LEVEL_FILE_VERSION, tiles.Width, tiles.Height, 
+                                palette.size() <= 16 ? 4u : 8u, static_cast<uint32_t>(palette.size()), 0 };
+    size_t rowBytes = (static_cast<size_t>(tiles.Width) * header.BitsPerTile + 7) / 8;
+    std::vector<unsigned char> rows(rowBytes * tiles.Height, 0);
+    for (unsigned int y = 0; y < tiles.Height; ++y)
+    {
+        unsigned char *row = rows.data() + y * rowBytes;
+        for (unsigned int x = 0; x < tiles.Width; ++x)
+        {
+            unsigned int code = tiles.At(x, y);
+            unsigned char entry = std::lower_bound(palette.begin(), palette.end(), code) - palette.begin();
+            if (header.BitsPerTile == 8)
+                row[x] = entry;
+            else
+                row[x / 2] |= entry << (x % 2 * 4);
+        }
+    }
+    header.Checksum = HashBytes(rows.data(), rows.size(), HashBytes(palette.data(), palette.size() * sizeof(uint32_t)));
+
+    std::vector<unsigned char> data(reinterpret_cast<const unsigned char*>(&header), reinterpret_cast<const unsigned char*>(&header + 1));
+    data.insert(data.end(), reinterpret_cast<const unsigned char*>(palette.data()), 
+                reinterpret_cast<const unsigned char*>(palette.data() + palette.size()));
+    data.insert(data.end(), rows.begin(), rows.end());
+    return data;
+}
+
+bool DecodeLevel(const unsigned char *data, size_t size, LevelTiles &tiles, LevelParseError &error)
+{
+    tiles = { 0, 0, {} };
+    if (!IsCompiledLevel(data, size))
+        return fail(error, "not a compiled level", 0, 0);
+    LevelFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.Version != LEVEL_FILE_VERSION)
+        return fail(error, "compiled level version " + std::to_string(header.Version) + ", expected " + 
+                    std::to_string(LEVEL_FILE_VERSION) + ", run make lvlc again", 0, 0);
+    if ((header.BitsPerTile != 4 && header.BitsPerTile != 8) || header.PaletteSize == 0 || 
+        header.PaletteSize > (1u << header.BitsPerTile) || header.Width == 0 || header.Height == 0)
+        return fail(error, "invalid compiled level header", 0, 0);
+    size_t rowBytes = (static_cast<size_t>(header.Width) * header.BitsPerTile + 7) / 8;
+    size_t paletteBytes = header.PaletteSize * sizeof(uint32_t);
+    if (size != sizeof(header) + paletteBytes + rowBytes * header.Height)
+        return fail(error, "compiled level is truncated or has trailing bytes", 0, 0);
+    const unsigned char *paletteData = data + sizeof(header), *rows = paletteData + paletteBytes;
+    if (HashBytes(rows, rowBytes * header.Height, HashBytes(paletteData, paletteBytes)) != header.Checksum)
+        return fail(error, "compiled level checksum mismatch", 0, 0);
+
+    uint32_t palette[256] = {};
+    std::memcpy(palette, paletteData, paletteBytes);
+    tiles.Width = header.Width;
+    tiles.Height = header.Height;
+    tiles.Codes.resize(static_cast<size_t>(header.Width) * header.Height);
+    unsigned int *codes = tiles.Codes.data();
+    for (unsigned int y = 0; y < header.Height; ++y, rows += rowBytes)
+    {
+        // indices past the palette decode to 0, the checksum already vouched for the data
+        if (header.BitsPerTile == 8)
+            for (unsigned int x = 0; x < header.Width; ++x)
+                *codes++ = palette[rows[x]];
+        else
+            for (unsigned int x = 0; x < header.Width; ++x)
+                *codes++ = palette[(rows[x / 2] >> (x % 2 * 4)) & 0xF];
+    }
+    return true;
+}
+
+std::string CompiledLevelPath(const std::string &file)
+{
+    return file + "c";
+}
+
+bool ReadLevelFile(const char *file, LevelTiles &tiles, LevelParseError &error)
+{
+    tiles = { 0, 0, {} };
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return fail(error, std::string("could not open the file: ") + std::strerror(errno), 0, 0);
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return fail(error, std::string("could not open the file: ") + std::strerror(errno), 0, 0);
+    }
+    // an empty file can't be mapped
+    if (info.st_size == 0)
+    {
+        close(fd);
+        return fail(error, "level has no tiles", 1, 1);
+    }
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive on its own
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return fail(error, std::string("could not map the file: ") + std::strerror(errno), 0, 0);
+    // read front to back once
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+    bool parsed = IsCompiledLevel(mapping, info.st_size)
+        ? DecodeLevel(static_cast<const unsigned char*>(mapping), info.st_size, tiles, error)
+        : ParseLevel(static_cast<const char*>(mapping), info.st_size, tiles, error);
+    munmap(mapping, info.st_size);
+    return parsed;
+}
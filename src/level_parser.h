@@ -0,0 +1,65 @@
+#ifndef LEVEL_PARSER_H
+#define LEVEL_PARSER_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// read-only row-major tile codes, 0 empty, 1 solid and higher a colored brick; points into a
+// LevelTiles or straight into the asset pack
+struct TileView {
+    const unsigned int *Codes;
+    unsigned int Width, Height;
+
+    unsigned int At(unsigned int x, unsigned int y) const { return Codes[y * Width + x]; }
+};
+
+// a parsed level, row-major in one buffer
+struct LevelTiles {
+    unsigned int Width, Height;
+    std::vector<unsigned int> Codes;
+
+    TileView View() const { return { Codes.data(), Width, Height }; }
+};
+
+// where and why a level failed to parse; Line and Column are 1-based, Column counts bytes
+struct LevelParseError {
+    std::string Message;
+    unsigned int Line, Column;
+};
+
+// Parses the text of a level: rows of decimal tile codes separated by spaces or tabs, one row per
+// line. The first row sets the width and shorter rows are padded with empty tiles; blank lines
+// only count as rows when more tiles follow. A longer row or anything but digits and whitespace
+// is an error. Scans the bytes in place, the text doesn't need to be null terminated. On an error
+// tiles holds what was parsed up to it.
+bool ParseLevel(const char *text, size_t size, LevelTiles &tiles, LevelParseError &error);
+
+// Compiled levels, written by tools/level_compiler.cpp ("make lvlc"). Layout: LevelFileHeader,
+// PaletteSize uint32_t tile codes, then Height rows of Width palette indices of BitsPerTile bits
+// each. Every row starts on a byte and 4-bit rows hold the first of two tiles in the low nibble.
+const uint32_t LEVEL_FILE_VERSION = 1;
+
+struct LevelFileHeader {
+    char Magic[4];          // "BKLV"
+    uint32_t Version;
+    uint32_t Width, Height;
+    uint32_t BitsPerTile;   // 4 for up to 16 distinct codes, else 8
+    uint32_t PaletteSize;   // at most 256
+    uint64_t Checksum;      // HashBytes of the palette and the tile rows
+};
+
+// true if the data starts like a compiled level
+bool IsCompiledLevel(const void *data, size_t size);
+// the compiled form of the tiles, empty if they use more than 256 distinct codes
+std::vector<unsigned char> CompileLevel(TileView tiles);
+// unpacks a compiled level, errors are reported at line 0
+bool DecodeLevel(const unsigned char *data, size_t size, LevelTiles &tiles, LevelParseError &error);
+// where lvlc writes the compiled form of a text level, "levels/one.lvl" becomes "levels/one.lvlc"
+std::string CompiledLevelPath(const std::string &file);
+
+// memory maps the file and parses it without copying, compiled or text as its first bytes tell, 
+// see ParseLevel and DecodeLevel; a file that can't be opened is reported at line 0
+bool ReadLevelFile(const char *file, LevelTiles &tiles, LevelParseError &error);
+
+#endif
@@ -3,8 +3,15 @@
 
 #include "game.h"
 #include "resource_manager.h"
+#include "gl_extensions.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
 // GLFW function declerations
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -12,6 +19,8 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 static void cursor_position_callback(GLFWwindow *window, double xPos, double yPos);
 void cursor_enter_callback(GLFWwindow *window, int entered);
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
+static void runBenchmark(GLFWwindow *window);
+static bool parseCount(const char *option, const char *text, unsigned long max, unsigned long &value);
 
 const unsigned int SCREEN_WIDTH = 800;
 const unsigned int SCREEN_HEIGHT = 600;
@@ -20,12 +29,58 @@ Game Breakout(SCREEN_WIDTH, SCREEN_HEIGHT);
 
 int main(int argc, char *argv[])
 {
+    // --threads N sets the number of vertex building workers, 0 keeps it on the main thread
+    // --msaa N picks 0, 2, 4 or 8 samples, --fxaa adds the FXAA resolve pass, --benchmark times 
+    // every antialiasing setting and exits, --texture-budget MB evicts unused textures above it, 
+    // --hot-reload swaps edited shaders, textures and levels in while the game runs, --scroll keeps 
+    // bricks at a fixed size and scrolls levels taller than the screen
+    bool benchmark = false;
+    size_t textureBudget = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        unsigned long value;
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            // more workers than cores only contend with the main thread
+            if (!parseCount("--threads", argv[++i], std::max(std::thread::hardware_concurrency(), 1u), value))
+                return 1;
+            Breakout.WorkerThreads = value;
+        }
+        else if (std::strcmp(argv[i], "--msaa") == 0 && i + 1 < argc)
+        {
+            if (!parseCount("--msaa", argv[++i], 8, value) || (value != 0 && value != 2 && value != 4 && value != 8))
+            {
+                std::cout << "ERROR::ARGS: --msaa takes 0, 2, 4 or 8 samples" << std::endl;
+                return 1;
+            }
+            Breakout.Samples = value;
+        }
+        else if (std::strcmp(argv[i], "--fxaa") == 0)
+            Breakout.FXAA = true;
+        else if (std::strcmp(argv[i], "--benchmark") == 0)
+            benchmark = true;
+        else if (std::strcmp(argv[i], "--hot-reload") == 0)
+            Breakout.HotReload = true;
+        else if (std::strcmp(argv[i], "--scroll") == 0)
+            Breakout.Scrolling = true;
+        else if (std::strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+        {
+            // capped so the byte count can't overflow
+            if (!parseCount("--texture-budget", argv[++i], SIZE_MAX / (1024 * 1024), value))
+                return 1;
+            textureBudget = static_cast<size_t>(value) * 1024 * 1024;
+        }
+    }
+
     glfwInit();
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RESIZABLE, false);
+    // antialiasing is done by the post processor's own buffers, the window stays single sampled 
+    // so the multisampled scene can be resolved straight into it
+    glfwWindowHint(GLFW_SAMPLES, 0);
 
     GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Breakout", nullptr, nullptr);
     glfwMakeContextCurrent(window);
@@ -36,6 +91,7 @@ int main(int argc, char *argv[])
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    GLExtensions::Load();
 
     glfwSetKeyCallback(window, key_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
@@ -49,7 +105,23 @@ int main(int argc, char *argv[])
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // a warm start restores every program from the binary cache, a cold one compiles them
+    double startupBegin = glfwGetTime();
+    ResourceManager::SetTextureBudget(textureBudget);
     Breakout.Init();
+    std::cout << "Startup: " << (glfwGetTime() - startupBegin) * 1000.0 << " ms, shader cache " 
+                << (ResourceManager::ShaderCacheMisses == 0 ? "warm" : "cold") << " (" 
+                << ResourceManager::ShaderCacheHits << " restored, " << ResourceManager::ShaderCacheMisses 
+                << " compiled" << (GLExtensions::ParallelShaderCompile ? " in parallel" : "") << ")" << std::endl;
+
+    if (benchmark)
+    {
+        runBenchmark(window);
+        ResourceManager::Clear();
+        TextureRegistry::Clear();
+        glfwTerminate();
+        return 0;
+    }
 
     // deltaTime
     float deltaTime = 0.0f;
@@ -62,6 +134,7 @@ int main(int argc, char *argv[])
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
         glfwPollEvents();
+        Breakout.ApplyReloads();
         
 
         // User input
@@ -79,6 +152,8 @@ int main(int argc, char *argv[])
     }
 
     ResourceManager::Clear();
+    // render targets and the glyph atlas, owned by the registry as well
+    TextureRegistry::Clear();
 
     glfwTerminate();
     return 0;
@@ -148,3 +223,86 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions;
     glViewport(0, 0, width, height);
 }
+
+static bool parseCount(const char *option, const char *text, unsigned long max, unsigned long &value)
+{
+    // a whole non-negative number, clamped to max; atoi would turn "-1" into a huge unsigned count
+    char *end;
+    errno = 0;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < 0)
+    {
+        std::cout << "ERROR::ARGS: " << option << " expects a non-negative number, got \"" << text << "\"" << std::endl;
+        return false;
+    }
+    value = std::min(static_cast<unsigned long>(parsed), max);
+    return true;
+}
+
+// renders the menu scene for a fixed number of frames with every antialiasing setting and 
+// prints the average frame time and GPU time of each
+static void runBenchmark(GLFWwindow *window)
+{
+    struct Setting {
+        const char *Name;
+        unsigned int Samples;
+        bool FXAA;
+    };
+    const Setting settings[] = {
+        { "off",     0, false },
+        { "FXAA",    0, true  },
+        { "2x MSAA", 2, false },
+        { "4x MSAA", 4, false },
+        { "8x MSAA", 8, false }
+    };
+    const int warmupFrames = 30, timedFrames = 300;
+
+    // frames are not throttled to the display
+    glfwSwapInterval(0);
+    // timestamps rather than a GL_TIME_ELAPSED query, the post processor keeps one of those open 
+    // across its passes and they can't nest; a pair per frame in flight, each read back 
+    // QUERY_FRAMES frames later so the CPU never waits for the GPU to catch up
+    const int QUERY_FRAMES = 3;
+    unsigned int queries[QUERY_FRAMES][2];
+    glGenQueries(QUERY_FRAMES * 2, &queries[0][0]);
+    for (const Setting &setting : settings)
+    {
+        Breakout.SetAntialiasing(setting.Samples, setting.FXAA);
+        double gpuTime = 0.0, start = 0.0;
+        auto readQueries = [&queries, &gpuTime](int slot) {
+            GLuint64 begin, end;
+            glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+            gpuTime += (end - begin) / 1000000.0;
+        };
+        for (int frame = 0; frame < warmupFrames + timedFrames; ++frame)
+        {
+            int timed = frame - warmupFrames, slot = timed % QUERY_FRAMES;
+            if (timed == 0)
+                start = glfwGetTime();
+            glfwPollEvents();
+            Breakout.Update(1.0f / 60.0f);
+
+            if (timed >= 0)
+            {
+                // the frame that used this pair before is done by now
+                if (timed >= QUERY_FRAMES)
+                    readQueries(slot);
+                glQueryCounter(queries[slot][0], GL_TIMESTAMP);
+            }
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            Breakout.Render();
+            if (timed >= 0)
+                glQueryCounter(queries[slot][1], GL_TIMESTAMP);
+            glfwSwapBuffers(window);
+        }
+        double frameTime = (glfwGetTime() - start) * 1000.0 / timedFrames;
+        // the last frames are still in flight
+        for (int timed = std::max(timedFrames - QUERY_FRAMES, 0); timed < timedFrames; ++timed)
+            readQueries(timed % QUERY_FRAMES);
+        std::cout << setting.Name << " (" << Breakout.Samples << " samples" << (Breakout.FXAA ? ", FXAA" : "") 
+                    << "): " << frameTime << " ms/frame, " << gpuTime / timedFrames << " ms GPU" << std::endl;
+    }
+    glDeleteQueries(QUERY_FRAMES * 2, &queries[0][0]);
+}
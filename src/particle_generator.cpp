@@ -1,7 +1,9 @@
 #include "particle_generator.h"
 
-ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
-    : amount(amount), shader(shader), texture(texture)
+#include <cstdint>
+
+ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, StreamBuffer &stream)
+    : amount(amount), shader(shader), texture(texture), stream(&stream)
 {
     this->init();
 }
@@ -28,32 +30,65 @@ void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newPar
     }
 }
 
-void ParticleGenerator::renderParticle(Particle particle)
+void ParticleGenerator::BuildInstances(WorkerPool *pool)
 {
-    this->shader.SetVector2f("offset", particle.Position);
-    this->shader.SetVector4f("color", particle.Color);
-    this->texture.Bind();
+    // every particle owns a fixed slot, so workers write disjoint ranges of the staging buffer
+    auto build = [this](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i)
+        {
+            const Particle &p = this->particles[i];
+            float *out = &this->instanceData[i * 6];
+            bool visible = p.Life > 0.0f && p.Color.a > 0.0f;
+            out[0] = p.Position.x;
+            out[1] = p.Position.y;
+            out[2] = visible ? p.Color.r : 0.0f;
+            out[3] = visible ? p.Color.g : 0.0f;
+            out[4] = visible ? p.Color.b : 0.0f;
+            out[5] = visible ? p.Color.a : 0.0f;
+        }
+    };
+    if (pool)
+        pool->ParallelFor(this->amount, 128, build);
+    else
+        build(0, this->amount);
+}
+
+void ParticleGenerator::renderParticles()
+{
+    unsigned int offset = this->stream->Upload(this->instanceData.data(), sizeof(float) * this->instanceData.size());
+
     glBindVertexArray(this->VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindBuffer(GL_ARRAY_BUFFER, this->stream->ID);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(uintptr_t)offset);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(uintptr_t)(offset + 2 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, this->amount);
     glBindVertexArray(0);
 }
 
 void ParticleGenerator::Draw()
 {
+    this->BuildInstances(nullptr);
     // use additive blending gives 'glow' effect
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
     this->shader.Use();
-    for (Particle particle : this->particles)
-    {
-        if (particle.Life > 0.0f)
-        {
-            this->renderParticle(particle);
-        }
-    }
+    this->texture.Bind();
+    this->renderParticles();
     // Reset to default blending mode!
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
+void ParticleGenerator::Submit(RenderQueue &queue, RenderLayer layer)
+{
+    // use additive blending gives 'glow' effect
+    queue.Submit(layer, BLEND_ADDITIVE, this->shader.ID, this->texture.ID, &ParticleGenerator::execute, this);
+}
+
+void ParticleGenerator::execute(void *owner, const RenderCommand *commands, unsigned int count)
+{
+    static_cast<ParticleGenerator*>(owner)->renderParticles();
+}
+
 void ParticleGenerator::init()
 {
     // set up mesh and attribute properties
@@ -78,11 +113,19 @@ void ParticleGenerator::init()
     // set mesh attributes
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+    // per-instance offset and color, read from the stream buffer at each frame's upload
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
     // create default instances 
     for (unsigned int i = 0; i < this->amount; ++i)
         this->particles.push_back(Particle());
+    this->instanceData.resize(this->amount * 6);
 }
 
 void ParticleGenerator::respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset)
@@ -8,6 +8,9 @@
 #include "shader.h"
 #include "texture.h"
 #include "game_object.h"
+#include "render_queue.h"
+#include "worker_pool.h"
+#include "stream_buffer.h"
 
 struct Particle {
     glm::vec2 Position, Velocity;
@@ -21,11 +24,17 @@ class ParticleGenerator
 {
 public:
     
-    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount);
+    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, StreamBuffer &stream);
    
     void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
  
     void Draw();
+
+    // fills the instance staging buffer, split across the pool's workers when one is given
+    void BuildInstances(WorkerPool *pool);
+
+    // queues all live particles as one additive-blended command
+    void Submit(RenderQueue &queue, RenderLayer layer);
 private:
     // state
     std::vector<Particle> particles;
@@ -36,10 +45,16 @@ private:
     Shader shader;
     Texture2D texture;
     unsigned int VAO;
+    StreamBuffer *stream;
+    // <vec2 offset, vec4 color> per particle, dead particles are written with zero color
+    std::vector<float> instanceData;
    
     void init();
-    
-    void renderParticle(Particle particle);
+
+    // draws the particles, shader, texture and blending must already be set
+    void renderParticles();
+
+    static void execute(void *owner, const RenderCommand *commands, unsigned int count);
 
     // returns the first index that's currently unused or 0 if none is currently inactive
     unsigned int firstUnusedParticle();
@@ -1,28 +1,32 @@
 #include "post_process.h"
+#include "resource_manager.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
-PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int height) 
-    : PostProcessingShader(shader), Texture(), Width(width), Height(height), Confuse(false), Chaos(false), Shake(false)
+// CPU time in milliseconds for the offscreen pass
+static double nowMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PostProcessor::PostProcessor(Shader shader, const char *vShaderFile, const char *fShaderFile, unsigned int width, 
+                                unsigned int height, unsigned int samples) 
+    : PostProcessingShader(shader), Texture(), Width(width), Height(height), Confuse(false), Chaos(false), Shake(false), 
+        FXAA(false), Samples(0), Stats(), time(0.0f), path(PATH_DIRECT), nextQuery(0), measured(false), cpuStart(0.0)
 {   
+    glGenQueries(QUERY_COUNT, this->queries);
+    for (unsigned int i = 0; i < QUERY_COUNT; ++i)
+        this->queryPending[i] = false;
+
     glGenFramebuffers(1, &this->MSFBO);
     glGenFramebuffers(1, &this->FBO);
     glGenRenderbuffers(1, &this->RBO);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, this->RBO);
-
-    GLint max_samples;
-    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
-
-    // allocate storage for render buffer object
-    glRenderbufferStorageMultisample(GL_RENDERBUFFER, max_samples, GL_RGB, width, height); 
-    // attach MS render buffer object to framebuffer
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO); 
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
+    this->SetSamples(samples);
     
     glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
-    this->Texture.Generate(width, height, NULL);
+    this->Texture = TextureRegistry::Create(width, height, NULL);
 
     // attach texture to framebuffer as its color attachment
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Texture.ID, 0); 
@@ -31,7 +35,20 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     
     this->initRenderData();
-    this->PostProcessingShader.SetInteger("scene", 0, true);
+    this->initProgram(this->PostProcessingShader);
+
+    // the variant without effects runs whenever the offscreen pass is taken for measuring, 
+    // start compiling it right away
+    this->vertexSource = ResourceManager::LoadShaderSource(vShaderFile);
+    this->fragmentSource = ResourceManager::LoadShaderSource(fShaderFile);
+    for (unsigned int i = 0; i < EFFECT_VARIANTS; ++i)
+        this->variantState[i] = VARIANT_NONE;
+    this->program(0);
+}
+
+void PostProcessor::initProgram(Shader &shader)
+{
+    shader.SetInteger("scene", 0, true);
     float offset = 1.0f / 300.0f;
     float offsets[9][2] = {
         { -offset,  offset  },  // top-left
@@ -45,51 +62,222 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
         {  offset, -offset  }   // bottom-right    
     };
     
-    glUniform2fv(glGetUniformLocation(this->PostProcessingShader.ID, "offsets"), 9, (float*)offsets);
+    glUniform2fv(glGetUniformLocation(shader.ID, "offsets"), 9, (float*)offsets);
     int edge_kernel[9] = {
         -1, -1, -1,
         -1,  8, -1,
         -1, -1, -1
     };
 
-    glUniform1iv(glGetUniformLocation(this->PostProcessingShader.ID, "edge_kernel"), 9, edge_kernel);
+    glUniform1iv(glGetUniformLocation(shader.ID, "edge_kernel"), 9, edge_kernel);
     float blur_kernel[9] = {
         1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f,
         2.0f / 16.0f, 4.0f / 16.0f, 2.0f / 16.0f,
         1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f
     };
     
-    glUniform1fv(glGetUniformLocation(this->PostProcessingShader.ID, "blur_kernel"), 9, blur_kernel);    
+    glUniform1fv(glGetUniformLocation(shader.ID, "blur_kernel"), 9, blur_kernel);
 }
 
-void PostProcessor::BeginRender()
+Shader &PostProcessor::program(unsigned int mask)
 {
+    VariantState &state = this->variantState[mask];
+    Shader &variant = this->variants[mask];
+    if (state == VARIANT_NONE)
+    {
+        std::string defines;
+        if (mask & EFFECT_CHAOS)
+            defines += "#define EFFECT_CHAOS\n";
+        if (mask & EFFECT_CONFUSE)
+            defines += "#define EFFECT_CONFUSE\n";
+        if (mask & EFFECT_SHAKE)
+            defines += "#define EFFECT_SHAKE\n";
+        if (mask & EFFECT_FXAA)
+            defines += "#define EFFECT_FXAA\n";
+        variant.CompileAsync(this->vertexSource.c_str(), this->fragmentSource.c_str(), nullptr, defines.c_str());
+        state = VARIANT_COMPILING;
+    }
+    // polled from the next request on, so even without parallel compile support (where Ready is 
+    // always true) a threaded driver gets a frame before Finish has to wait for it
+    else if (state == VARIANT_COMPILING && variant.Ready())
+    {
+        if (variant.Finish())
+        {
+            this->initProgram(variant);
+            state = VARIANT_READY;
+        }
+        else
+        {
+            // the log is printed once, the variant isn't compiled again until the sources change
+            glDeleteProgram(variant.ID);
+            state = VARIANT_FAILED;
+        }
+    }
+    return state == VARIANT_READY ? variant : this->PostProcessingShader;
+}
+
+void PostProcessor::SetSources(const std::string &vertex, const std::string &fragment)
+{
+    this->vertexSource = vertex;
+    this->fragmentSource = fragment;
+    for (unsigned int i = 0; i < EFFECT_VARIANTS; ++i)
+    {
+        if (this->variantState[i] == VARIANT_COMPILING || this->variantState[i] == VARIANT_READY)
+            glDeleteProgram(this->variants[i].ID);
+        this->variantState[i] = VARIANT_NONE;
+    }
+    this->program(0);
+}
+
+void PostProcessor::SetSamples(unsigned int samples)
+{
+    GLint max_samples;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    samples = std::min(samples, static_cast<unsigned int>(max_samples));
+    if (samples == this->Samples)
+        return;
+    this->Samples = samples;
+    // without multisampling the scene is drawn into the window or the FBO texture directly
+    if (samples == 0)
+        return;
+
+    // (re)allocate storage for render buffer object, the attachment stays valid
+    glBindRenderbuffer(GL_RENDERBUFFER, this->RBO);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGB, this->Width, this->Height); 
     glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+    // attach MS render buffer object to framebuffer
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO); 
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool PostProcessor::effectActive() const
+{
+    return this->Confuse || this->Chaos || this->Shake;
+}
+
+void PostProcessor::BeginRender()
+{
+    this->collectQueries();
+    // the offscreen path also runs until its cost is known, its output is identical without effects
+    if (this->effectActive() || this->FXAA || !this->measured)
+        this->path = PATH_OFFSCREEN;
+    else
+        this->path = this->Samples > 0 ? PATH_RESOLVE : PATH_DIRECT;
+    this->Stats.Offscreen = this->path == PATH_OFFSCREEN;
+    if (this->path != PATH_OFFSCREEN)
+    {
+        this->Stats.SkippedFrames++;
+        this->Stats.SavedGpuMs += this->Stats.GpuMs;
+        this->Stats.SavedCpuMs += this->Stats.CpuMs;
+    }
+    if (this->Samples > 0)
+        glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, this->path == PATH_OFFSCREEN ? this->FBO : 0);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void PostProcessor::EndRender()
 {
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
-    glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    if (this->path == PATH_DIRECT)
+        return;
+    if (this->path == PATH_RESOLVE)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0); 
+        return;
+    }
+    this->cpuStart = nowMs();
+    // a query still in flight is skipped this frame rather than waited on
+    unsigned int query = this->nextQuery;
+    if (!this->queryPending[query])
+        glBeginQuery(GL_TIME_ELAPSED, this->queries[query]);
+    // without multisampling the scene already is in the texture
+    if (this->Samples > 0)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
+        glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, 0); 
 }
 
 void PostProcessor::Render(float time)
 {
-    this->PostProcessingShader.Use();
-    this->PostProcessingShader.SetFloat("time", time);
-    this->PostProcessingShader.SetInteger("confuse", this->Confuse);
-    this->PostProcessingShader.SetInteger("chaos", this->Chaos);
-    this->PostProcessingShader.SetInteger("shake", this->Shake);
+    if (this->path != PATH_OFFSCREEN)
+        return;
+    unsigned int mask = (this->Chaos ? EFFECT_CHAOS : 0) | (this->Confuse ? EFFECT_CONFUSE : 0) 
+                        | (this->Shake ? EFFECT_SHAKE : 0) | (this->FXAA ? EFFECT_FXAA : 0);
+    Shader &shader = this->program(mask);
+    this->Stats.Specialized = &shader != &this->PostProcessingShader;
+    shader.Use();
+    shader.SetFloat("time", time);
+    if (!this->Stats.Specialized)
+    {
+        shader.SetInteger("confuse", this->Confuse);
+        shader.SetInteger("chaos", this->Chaos);
+        shader.SetInteger("shake", this->Shake);
+        shader.SetInteger("fxaa", this->FXAA);
+    }
 
     glActiveTexture(GL_TEXTURE0);
     this->Texture.Bind();	
     glBindVertexArray(this->VAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
+
+    unsigned int query = this->nextQuery;
+    if (!this->queryPending[query])
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        this->queryPending[query] = true;
+        this->nextQuery = (query + 1) % QUERY_COUNT;
+    }
+    float cpu = static_cast<float>(nowMs() - this->cpuStart);
+    this->Stats.CpuMs = this->Stats.CpuMs > 0.0f ? 0.9f * this->Stats.CpuMs + 0.1f * cpu : cpu;
+}
+
+void PostProcessor::collectQueries()
+{
+    for (unsigned int i = 0; i < QUERY_COUNT; ++i)
+    {
+        if (!this->queryPending[i])
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(this->queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+        GLuint64 elapsed;
+        glGetQueryObjectui64v(this->queries[i], GL_QUERY_RESULT, &elapsed);
+        this->queryPending[i] = false;
+        float gpu = elapsed / 1000000.0f;
+        this->Stats.GpuMs = this->measured ? 0.9f * this->Stats.GpuMs + 0.1f * gpu : gpu;
+        this->measured = true;
+    }
+}
+
+void PostProcessor::Submit(RenderQueue &queue, float time)
+{
+    this->time = time;
+    queue.Submit(LAYER_SCENE_BEGIN, BLEND_ALPHA, 0, 0, &PostProcessor::executeBegin, this);
+    queue.Submit(LAYER_POST_PROCESS, BLEND_ALPHA, 0, 0, &PostProcessor::executeEnd, this);
+}
+
+void PostProcessor::executeBegin(void *owner, const RenderCommand *commands, unsigned int count)
+{
+    static_cast<PostProcessor*>(owner)->BeginRender();
+}
+
+void PostProcessor::executeEnd(void *owner, const RenderCommand *commands, unsigned int count)
+{
+    PostProcessor *effects = static_cast<PostProcessor*>(owner);
+    effects->EndRender();
+    effects->Render(effects->time);
 }
 
 void PostProcessor::initRenderData()
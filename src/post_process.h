@@ -1,36 +1,116 @@
 #ifndef POST_PROCESSOR_H
 #define POST_PROCESSOR_H
 
+#include <string>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "texture.h"
 #include "sprite_renderer.h"
 #include "shader.h"
+#include "render_queue.h"
+
+// cost of the offscreen pass (blit + effect shader) and what skipping it saved so far
+struct PostProcessStats {
+    bool Offscreen;             // last frame took the offscreen path
+    bool Specialized;           // it ran a specialized variant rather than the dynamic shader
+    float GpuMs, CpuMs;         // moving average per offscreen frame
+    unsigned int SkippedFrames;
+    double SavedGpuMs, SavedCpuMs;
+};
 
+// Renders the scene into an offscreen buffer (multisampled unless Samples is 0) and applies the 
+// effects and the optional FXAA pass on the way to the window. Without either the scene goes 
+// straight to the default framebuffer, or is only resolved into it when multisampled.
 class PostProcessor
 {
 public:
+    // compiled with EFFECT_DYNAMIC, used until the variant of the active effects is compiled
     Shader PostProcessingShader;
     Texture2D Texture;
     unsigned int Width, Height;
 
     bool Confuse, Chaos, Shake;
+    // FXAA-style edge smoothing in the effect pass, cheap antialiasing for low sample counts
+    bool FXAA;
+    // MSAA samples of the scene buffer, 0 renders without multisampling
+    unsigned int Samples;
+    PostProcessStats Stats;
 
-    PostProcessor(Shader shader, unsigned int width, unsigned int height);
+    // the shader files are kept to compile a specialized variant for every effect combination
+    PostProcessor(Shader shader, const char *vShaderFile, const char *fShaderFile, unsigned int width, 
+                    unsigned int height, unsigned int samples = 4);
 
+    // reallocates the multisampled buffer, samples is clamped to GL_MAX_SAMPLES
+    void SetSamples(unsigned int samples);
+
+    // binds the offscreen buffer when an effect is active (or its cost wasn't measured yet), 
+    // otherwise the default framebuffer, and clears it
     void BeginRender();
 
     void EndRender();
 
     void Render(float time);
+
+    // queues BeginRender at the start of the scene and EndRender + Render after it
+    void Submit(RenderQueue &queue, float time);
+
+    // drops the compiled variants and compiles them again from the new sources on demand, the 
+    // dynamic shader stands in until they are ready; used by hot reloading
+    void SetSources(const std::string &vertex, const std::string &fragment);
 private:
     // MSFBO = Multisampled FBO. FBO is regular, used for blitting MS color-buffer to texture
     unsigned int MSFBO, FBO; 
     unsigned int RBO; // RBO is used for multisampled color buffer
     unsigned int VAO;
+    float time;
+    // decided once per frame by BeginRender so EndRender and Render agree
+    enum Path {
+        PATH_DIRECT,    // scene drawn into the window
+        PATH_RESOLVE,   // scene drawn multisampled and blitted into the window
+        PATH_OFFSCREEN  // scene resolved into Texture and drawn with the effect shader
+    } path;
+
+    // GL_TIME_ELAPSED queries of recent offscreen frames, read back a few frames later to avoid stalls
+    static const unsigned int QUERY_COUNT = 4;
+    unsigned int queries[QUERY_COUNT];
+    bool queryPending[QUERY_COUNT];
+    unsigned int nextQuery;
+    bool measured;
+    double cpuStart;
+
+    // bit per effect, a mask selects one of the specialized variants
+    enum EffectBits {
+        EFFECT_CHAOS    = 1,
+        EFFECT_CONFUSE  = 2,
+        EFFECT_SHAKE    = 4,
+        EFFECT_FXAA     = 8,
+        EFFECT_VARIANTS = 16
+    };
+    enum VariantState {
+        VARIANT_NONE,
+        VARIANT_COMPILING,
+        VARIANT_READY,
+        VARIANT_FAILED      // didn't compile or link, the dynamic shader is used instead
+    };
+    std::string vertexSource, fragmentSource;
+    Shader variants[EFFECT_VARIANTS];
+    VariantState variantState[EFFECT_VARIANTS];
+
+    // the variant for mask once the driver finished it, starting its compile on first request; 
+    // the dynamic shader stands in meanwhile
+    Shader &program(unsigned int mask);
+    // sets the sampler and kernel uniforms every program needs
+    void initProgram(Shader &shader);
+
+    bool effectActive() const;
+    void collectQueries();
 
     void initRenderData();
+
+    static void executeBegin(void *owner, const RenderCommand *commands, unsigned int count);
+    static void executeEnd(void *owner, const RenderCommand *commands, unsigned int count);
 };
 
 #endif
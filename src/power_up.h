@@ -11,6 +11,7 @@
 #include "game_object.h"
 #include "ball_object.h"
 #include "post_process.h"
+#include "resource_manager.h"
 
 const glm::vec2 POWERUP_SIZE(60.0f, 20.0f);
 
@@ -23,9 +24,12 @@ public:
     std::string Type;
     float       Duration;	
     bool        Activated;
+    // acquired for as long as the power-up exists, the owner releases it when removing the power-up
+    TextureID   Skin;
     
-    PowerUp(std::string type, glm::vec3 color, float duration, glm::vec2 position, Texture2D texture) 
-        : GameObject(position, POWERUP_SIZE, texture, color, VELOCITY), Type(type), Duration(duration), Activated() { }
+    PowerUp(std::string type, glm::vec3 color, float duration, glm::vec2 position, TextureID skin) 
+        : GameObject(position, POWERUP_SIZE, ResourceManager::AcquireTexture(skin), color, VELOCITY), Type(type), 
+            Duration(duration), Activated(), Skin(skin) { }
 };
 
 bool ShouldSpawn(unsigned int chance);
@@ -0,0 +1,111 @@
+#include "render_queue.h"
+
+#include <algorithm>
+
+#include <glad/glad.h>
+
+// the submission index doubles as the lowest key bits, so sorted keys map back to their command
+const uint64_t SEQUENCE_MASK = (1u << 24) - 1;
+
+RenderQueue::RenderQueue()
+    : Stats(), Frame(0) { }
+
+uint64_t RenderQueue::MakeKey(RenderLayer layer, BlendMode blend, unsigned int shader, unsigned int texture, 
+                                unsigned int sequence)
+{
+    return (static_cast<uint64_t>(layer & 0xFF) << 56) 
+         | (static_cast<uint64_t>(blend & 0xF) << 52) 
+         | (static_cast<uint64_t>(shader & 0xFFF) << 40) 
+         | (static_cast<uint64_t>(texture & 0xFFFF) << 24) 
+         | (sequence & SEQUENCE_MASK);
+}
+
+RenderCommand &RenderQueue::Submit(RenderLayer layer, BlendMode blend, unsigned int shader, unsigned int texture, 
+                                    RenderCallback callback, void *owner)
+{
+    RenderCommand command = RenderCommand();
+    command.Key = MakeKey(layer, blend, shader, texture, this->commands.size());
+    command.Shader = shader;
+    command.Texture = texture;
+    command.Blend = blend;
+    command.Callback = callback;
+    command.Owner = owner;
+    this->commands.push_back(command);
+    return this->commands.back();
+}
+
+void RenderQueue::Execute()
+{
+    this->Stats = RenderStats();
+    this->Stats.Commands = this->commands.size();
+
+    this->keys.clear();
+    for (const RenderCommand &command : this->commands)
+        this->keys.push_back(command.Key);
+    std::sort(this->keys.begin(), this->keys.end());
+
+    // reorder so that batches are contiguous in memory for the callbacks
+    this->sorted.clear();
+    for (uint64_t key : this->keys)
+        this->sorted.push_back(this->commands[key & SEQUENCE_MASK]);
+    std::vector<RenderCommand> &sorted = this->sorted;
+
+    // cached GL state, ~0 means unknown
+    unsigned int shader = ~0u, texture = ~0u;
+    int blend = BLEND_ALPHA;
+
+    unsigned int i = 0;
+    while (i < sorted.size())
+    {
+        const RenderCommand &first = sorted[i];
+        unsigned int count = 1;
+        while (i + count < sorted.size())
+        {
+            const RenderCommand &next = sorted[i + count];
+            if (next.Callback != first.Callback || next.Owner != first.Owner || next.Shader != first.Shader 
+                || next.Texture != first.Texture || next.Blend != first.Blend)
+                break;
+            ++count;
+        }
+
+        if (first.Blend != blend)
+        {
+            if (first.Blend == BLEND_ADDITIVE)
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+            else
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            blend = first.Blend;
+            ++this->Stats.BlendSwitches;
+        }
+        if (first.Shader != 0 && first.Shader != shader)
+        {
+            glUseProgram(first.Shader);
+            shader = first.Shader;
+            ++this->Stats.ShaderSwitches;
+        }
+        if (first.Texture != 0 && first.Texture != texture)
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, first.Texture);
+            texture = first.Texture;
+            ++this->Stats.TextureSwitches;
+        }
+
+        first.Callback(first.Owner, &sorted[i], count);
+        ++this->Stats.Batches;
+
+        // callbacks that manage their own state leave it unknown
+        if (first.Shader == 0)
+            shader = ~0u;
+        if (first.Texture == 0)
+            texture = ~0u;
+        i += count;
+    }
+
+    // Reset to default blending mode!
+    if (blend != BLEND_ALPHA)
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    this->commands.clear();
+    ++this->Frame;
+}
@@ -0,0 +1,76 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+#include <cstdint>
+#include <vector>
+
+// Draw order, lower layers are executed first. Commands inside a layer may be 
+// reordered to group shaders and textures, so anything that must overlap in a
+// fixed order belongs in different layers.
+enum RenderLayer {
+    LAYER_SCENE_BEGIN,
+    LAYER_BACKGROUND,
+    LAYER_BRICKS,
+    LAYER_PADDLE,
+    LAYER_POWERUPS,
+    LAYER_PARTICLES,
+    LAYER_BALL,
+    LAYER_POST_PROCESS,
+    LAYER_HUD
+};
+
+enum BlendMode {
+    BLEND_ALPHA,
+    BLEND_ADDITIVE
+};
+
+struct RenderCommand;
+
+// executes a run of consecutive commands that share owner, callback and render state
+typedef void (*RenderCallback)(void *owner, const RenderCommand *commands, unsigned int count);
+
+struct RenderCommand {
+    uint64_t       Key;
+    unsigned int   Shader;   // program bound by the queue, 0 if the callback binds its own
+    unsigned int   Texture;  // texture bound to unit 0 by the queue, 0 if the callback binds its own
+    BlendMode      Blend;
+    RenderCallback Callback;
+    void          *Owner;
+    unsigned int   Payload;  // owner-defined index
+    float          Data[8];  // owner-defined inline payload
+};
+
+// report of the last executed frame
+struct RenderStats {
+    unsigned int Commands;
+    unsigned int Batches;
+    unsigned int ShaderSwitches;
+    unsigned int TextureSwitches;
+    unsigned int BlendSwitches;
+};
+
+class RenderQueue
+{
+public:
+    RenderStats Stats;
+    // incremented after every Execute, lets owners drop per-frame storage lazily
+    unsigned int Frame;
+
+    RenderQueue();
+
+    // appends a command and returns it so the owner can fill Payload/Data
+    RenderCommand &Submit(RenderLayer layer, BlendMode blend, unsigned int shader, unsigned int texture, 
+                            RenderCallback callback, void *owner);
+
+    // sorts the frame's commands, runs them with minimal state changes and clears the queue
+    void Execute();
+
+    // layer | blend | shader | texture | submission order, from most to least significant bits
+    static uint64_t MakeKey(RenderLayer layer, BlendMode blend, unsigned int shader, unsigned int texture, 
+                                unsigned int sequence);
+
+private:
+    std::vector<RenderCommand> commands, sorted;
+    std::vector<uint64_t> keys;
+};
+
+#endif
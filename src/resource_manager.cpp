@@ -1,5 +1,13 @@
 #include "resource_manager.h"
+#include "hash.h"
+#include "worker_pool.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -7,104 +15,618 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-std::map<std::string, Texture2D>    ResourceManager::Textures;
-std::map<std::string, Shader>       ResourceManager::Shaders;
+std::vector<Texture2D>              ResourceManager::Textures;
+std::vector<Shader>                 ResourceManager::Shaders;
+unsigned int                        ResourceManager::ShaderCacheHits = 0;
+unsigned int                        ResourceManager::ShaderCacheMisses = 0;
+std::vector<ResourceManager::PendingShader> ResourceManager::pendingShaders;
+std::vector<ResourceManager::QueuedTexture> ResourceManager::queuedTextures;
+AssetPack                           ResourceManager::Pack;
+TextureResidency                    ResourceManager::Residency = { 0, 0, 0, 0, 0, 0.0 };
+std::vector<ResourceManager::TextureSource> ResourceManager::textureSources;
+std::vector<ResourceManager::ShaderSource> ResourceManager::shaderSources;
+uint64_t                            ResourceManager::useTick = 0;
+std::unordered_map<std::string, unsigned int> ResourceManager::textureNames;
+std::unordered_map<std::string, unsigned int> ResourceManager::shaderNames;
+std::shared_mutex                   ResourceManager::mutex;
 
 
 Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, 
-                                    const char *gShaderFile, std::string name)
+                                    const char *gShaderFile, std::string name, const char *defines)
 {
-    Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
-    return Shaders[name];
+    Shader shader = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile, defines, name);
+    ShaderSource source = { vShaderFile, fShaderFile, gShaderFile ? gShaderFile : "", defines ? defines : "" };
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    ShaderID id = intern(shaderNames, name, Shaders.size());
+    if (id == Shaders.size())
+    {
+        Shaders.push_back(shader);
+        shaderSources.push_back(source);
+    }
+    else
+    {
+        Shaders[id] = shader;
+        shaderSources[id] = source;
+    }
+    return shader;
 }
 
-Shader ResourceManager::GetShader(std::string name)
+std::vector<ShaderID> ResourceManager::ShadersUsing(const std::string &file)
 {
-    return Shaders[name];
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<ShaderID> ids;
+    for (unsigned int i = 0; i < shaderSources.size(); ++i)
+    {
+        const ShaderSource &source = shaderSources[i];
+        if (source.Vertex == file || source.Fragment == file || source.Geometry == file)
+            ids.push_back(i);
+    }
+    return ids;
+}
+
+Shader ResourceManager::RecompileShader(ShaderID id)
+{
+    ShaderSource source;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        source = shaderSources[id];
+    }
+    // the loose files are what is being edited, the pack would hold the old version
+    std::string vertexCode = ReadFile(source.Vertex.c_str());
+    std::string fragmentCode = ReadFile(source.Fragment.c_str());
+    std::string geometryCode = source.Geometry.empty() ? "" : ReadFile(source.Geometry.c_str());
+    Shader shader;
+    shader.CompileAsync(vertexCode.c_str(), fragmentCode.c_str(), source.Geometry.empty() ? nullptr : geometryCode.c_str(), 
+                        source.Defines.empty() ? nullptr : source.Defines.c_str());
+    return shader;
+}
+
+bool ResourceManager::ReplaceShader(ShaderID id, Shader &compiled)
+{
+    if (!compiled.Linked())
+    {
+        // prints the log, the running program is left alone
+        compiled.Finish();
+        glDeleteProgram(compiled.ID);
+        compiled.ID = 0;
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Shaders[id].Replace(compiled);
+    return true;
+}
+
+std::string ResourceManager::ReadFile(const char *file)
+{
+    std::ifstream stream(file);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    if (!stream)
+        std::cout << "ERROR::RESOURCE: Failed to read file " << file << std::endl;
+    return contents.str();
+}
+
+bool ResourceManager::OpenPack(const char *file)
+{
+    return Pack.Open(file);
+}
+
+std::string ResourceManager::LoadShaderSource(const char *file)
+{
+    if (const PackEntry *entry = Pack.Find(file, PACK_SHADER))
+        return std::string(reinterpret_cast<const char*>(Pack.Data(*entry)), entry->Size);
+
+    return ReadFile(file);
+}
+
+ShaderID ResourceManager::FindShader(const std::string &name)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iter = shaderNames.find(name);
+    if (iter == shaderNames.end())
+        unknownResource("shader", name);
+    return iter->second;
+}
+
+Shader ResourceManager::GetShader(ShaderID id)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return Shaders[id];
 }
 
 Texture2D ResourceManager::LoadTexture(const char *file, bool alpha, std::string name)
 {
-    Textures[name] = loadTextureFromFile(file, alpha);
-    return Textures[name];
+    Texture2D texture;
+    if (!loadTextureFromPack(file, alpha, texture))
+        loadTextureFromFile(file, alpha, texture);
+    storeTexture(name, file, alpha, texture);
+    return texture;
 }
 
-Texture2D ResourceManager::GetTexture(std::string name)
+TextureID ResourceManager::FindTexture(const std::string &name)
 {
-    return Textures[name];
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iter = textureNames.find(name);
+    if (iter == textureNames.end())
+        unknownResource("texture", name);
+    return iter->second;
 }
 
-void ResourceManager::Clear()
-{    
-    for (auto iter : Shaders)
-        glDeleteProgram(iter.second.ID);
-    for (auto iter : Textures)
-        glDeleteTextures(1, &iter.second.ID);
+Texture2D ResourceManager::GetTexture(TextureID id)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return Textures[id];
 }
 
-Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile)
+unsigned int ResourceManager::intern(std::unordered_map<std::string, unsigned int> &names, const std::string &name, 
+                                        unsigned int next)
 {
-    // get vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
-    try
+    return names.emplace(name, next).first->second;
+}
+
+void ResourceManager::unknownResource(const char *kind, const std::string &name)
+{
+    // a typo in a resource name would otherwise render with texture/program 0 unnoticed
+    std::cout << "ERROR::RESOURCE: Unknown " << kind << " \"" << name << "\", it was never loaded" << std::endl;
+    std::abort();
+}
+
+void ResourceManager::QueueTexture(const char *file, bool alpha, std::string name)
+{
+    // packed textures are already decoded, nothing to wait for
+    Texture2D texture;
+    if (loadTextureFromPack(file, alpha, texture))
+        storeTexture(name, file, alpha, texture);
+    else
+        queuedTextures.push_back({ file, name, alpha, 0, nullptr, 0, nullptr, false, 0, 0, 0.0, 0.0 });
+}
+
+// milliseconds since the given start, for the loading timeline
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ResourceManager::LoadQueuedTextures(WorkerPool *pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::mutex mutex;
+    std::condition_variable decoded;
+    std::vector<unsigned int> finished;
+
+    // every decode is its own task, the largest files go first so they overlap the most
+    std::vector<unsigned int> order(queuedTextures.size());
+    for (unsigned int i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::error_code error;
+    auto fileSize = [&error](const std::string &file) { return std::filesystem::file_size(file, error); };
+    std::stable_sort(order.begin(), order.end(), [&fileSize](unsigned int a, unsigned int b) {
+        return fileSize(queuedTextures[a].File) > fileSize(queuedTextures[b].File);
+    });
+    // mapped before any decode starts, GL calls stay on this thread and the workers only write memory
+    for (QueuedTexture &queued : queuedTextures)
+        mapPixelBuffer(queued);
+    for (unsigned int index : order)
     {
-        std::ifstream vertexShaderFile(vShaderFile);
-        std::ifstream fragmentShaderFile(fShaderFile);
-        std::stringstream vShaderStream, fShaderStream;
+        auto decode = [index, start, &mutex, &decoded, &finished]() {
+            QueuedTexture &queued = queuedTextures[index];
+            int nrChannels;
+            queued.DecodeBegin = elapsedMs(start);
+            // always the channel count of the texture format, so the upload size is known
+            queued.Data = stbi_load(queued.File.c_str(), &queued.Width, &queued.Height, &nrChannels, 
+                                    queued.Alpha ? 4 : 3);
+            // the copy into the pixel buffer is done here rather than on the main thread
+            size_t size = static_cast<size_t>(queued.Width) * queued.Height * (queued.Alpha ? 4 : 3);
+            if (queued.Data && queued.Mapped && size == queued.MappedSize)
+            {
+                std::memcpy(queued.Mapped, queued.Data, size);
+                stbi_image_free(queued.Data);
+                queued.Data = nullptr;
+                queued.Buffered = true;
+            }
+            queued.DecodeEnd = elapsedMs(start);
+            // notified under the lock: once the last index is in, the main thread can return and 
+            // destroy the mutex and condition variable as soon as the lock is released
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(index);
+            decoded.notify_one();
+        };
+        if (pool)
+            pool->Async(decode);
+        else
+            decode();
+    }
 
-        vShaderStream << vertexShaderFile.rdbuf();
-        fShaderStream << fragmentShaderFile.rdbuf();
+    // upload in completion order, helping with the decodes whenever nothing is ready yet
+    double slowest = 0.0, total = 0.0;
+    for (unsigned int uploaded = 0; uploaded < queuedTextures.size(); ++uploaded)
+    {
+        unsigned int index;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!finished.empty())
+                {
+                    index = finished.front();
+                    finished.erase(finished.begin());
+                    break;
+                }
+            }
+            if (pool && pool->RunTask())
+                continue;
+            std::unique_lock<std::mutex> lock(mutex);
+            decoded.wait(lock, [&finished]() { return !finished.empty(); });
+        }
 
-        vertexShaderFile.close();
-        fragmentShaderFile.close();
+        QueuedTexture &queued = queuedTextures[index];
+        storeTexture(queued.Name, queued.File, queued.Alpha, uploadTexture(textureParams(queued.Alpha), queued));
 
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        double decodeTime = queued.DecodeEnd - queued.DecodeBegin;
+        slowest = std::max(slowest, decodeTime);
+        total += decodeTime;
+        std::cout << "Texture " << queued.Name << ": decoded " << queued.DecodeBegin << "-" << queued.DecodeEnd 
+                    << " ms, uploaded at " << elapsedMs(start) << " ms" << std::endl;
+    }
+    std::cout << "Textures: " << queuedTextures.size() << " loaded in " << elapsedMs(start) << " ms (slowest decode " 
+                << slowest << " ms, all decodes " << total << " ms)" << std::endl;
+    queuedTextures.clear();
+}
+
+void ResourceManager::storeTexture(const std::string &name, const std::string &file, bool alpha, Texture2D texture)
+{
+    // a reload keeps the ID and replaces the texture, handles to the old one must not outlive it
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    TextureID id = intern(textureNames, name, Textures.size());
+    if (id == Textures.size())
+    {
+        Textures.push_back(texture);
+        textureSources.push_back({ file, alpha, 0, 0, 0, false });
+    }
+    else
+    {
+        TextureRegistry::Destroy(Textures[id]);
+        Textures[id] = texture;
+        setResident(id, false);
+        textureSources[id].File = file;
+        textureSources[id].Alpha = alpha;
+    }
+    textureSources[id].LastUse = ++useTick;
+    setResident(id, true);
+    evictOverBudget();
+}
+
+unsigned int ResourceManager::ReloadTexture(const std::string &file, const unsigned char *pixels, int width, int height)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    unsigned int reloaded = 0;
+    for (unsigned int i = 0; i < textureSources.size(); ++i)
+    {
+        TextureSource &source = textureSources[i];
+        // evicted textures pick the new file up when they are acquired again
+        if (source.File != file || !source.Resident)
+            continue;
+        TextureParams params = textureParams(source.Alpha);
+        params.Image_Format = GL_RGBA;
+        setResident(i, false);
+        TextureRegistry::Update(Textures[i], width, height, pixels, params);
+        setResident(i, true);
+        reloaded++;
+    }
+    evictOverBudget();
+    return reloaded;
+}
+
+void ResourceManager::SetTextureBudget(size_t bytes)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Residency.BudgetBytes = bytes;
+    evictOverBudget();
+}
 
-        if (gShaderFile != nullptr)
+Texture2D ResourceManager::AcquireTexture(TextureID id)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    TextureSource &source = textureSources[id];
+    source.References++;
+    source.LastUse = ++useTick;
+    if (!source.Resident)
+    {
+        // the caller needs it now, this is the stall the budget trades for memory
+        auto start = std::chrono::steady_clock::now();
+        if (!loadTextureFromPack(source.File.c_str(), source.Alpha, Textures[id]))
+            loadTextureFromFile(source.File.c_str(), source.Alpha, Textures[id]);
+        setResident(id, true);
+        Residency.ReloadStalls++;
+        Residency.StallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        evictOverBudget();
+    }
+    return Textures[id];
+}
+
+void ResourceManager::ReleaseTexture(TextureID id)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    TextureSource &source = textureSources[id];
+    if (source.References == 0)
+    {
+        std::cout << "ERROR::TEXTURE: Released texture " << id << " more often than acquired" << std::endl;
+        return;
+    }
+    source.References--;
+    source.LastUse = ++useTick;
+    evictOverBudget();
+}
+
+void ResourceManager::setResident(TextureID id, bool resident)
+{
+    TextureSource &source = textureSources[id];
+    if (source.Resident == resident)
+        return;
+    source.Resident = resident;
+    if (resident)
+    {
+        // as specified, compressed and mipmapped textures are accounted for by the registry
+        source.Bytes = TextureRegistry::Bytes(Textures[id]);
+        Residency.ResidentBytes += source.Bytes;
+        Residency.Resident++;
+    }
+    else
+    {
+        Residency.ResidentBytes -= source.Bytes;
+        Residency.Resident--;
+    }
+}
+
+void ResourceManager::evictOverBudget()
+{
+    if (Residency.BudgetBytes == 0)
+        return;
+    while (Residency.ResidentBytes > Residency.BudgetBytes)
+    {
+        // the least recently used texture nobody holds, a linear scan is fine for a few hundred textures
+        int victim = -1;
+        for (unsigned int i = 0; i < textureSources.size(); ++i)
+        {
+            const TextureSource &source = textureSources[i];
+            if (source.Resident && source.References == 0 && 
+                    (victim < 0 || source.LastUse < textureSources[victim].LastUse))
+                victim = i;
+        }
+        if (victim < 0)
+            return;
+        TextureRegistry::Evict(Textures[victim]);
+        setResident(victim, false);
+        Residency.Evictions++;
+    }
+}
+
+bool ResourceManager::loadTextureFromPack(const char *file, bool alpha, Texture2D &texture)
+{
+    TextureParams params = textureParams(alpha);
+    // block compressed mip chain, uploaded as is or decoded by the registry without S3TC
+    if (const PackEntry *entry = Pack.Find(file, PACK_TEXTURE_BC))
+    {
+        BlockFormat format = static_cast<BlockFormat>(entry->Format);
+        if (texture.ID == 0)
+            texture = TextureRegistry::CreateCompressed(entry->Width, entry->Height, format, entry->Levels, 
+                                                        Pack.Data(*entry), params);
+        else
+            TextureRegistry::UpdateCompressed(texture, entry->Width, entry->Height, format, entry->Levels, 
+                                                Pack.Data(*entry), params);
+        return true;
+    }
+    const PackEntry *entry = Pack.Find(file, PACK_TEXTURE);
+    if (!entry)
+        return false;
+    // packed pixels are always RGBA, the alpha flag only picks the stored format
+    params.Image_Format = GL_RGBA;
+    specifyTexture(texture, entry->Width, entry->Height, Pack.Data(*entry), params);
+    return true;
+}
+
+TextureParams ResourceManager::textureParams(bool alpha)
+{
+    // sprites are drawn smaller than their images, trilinear filtering keeps them from shimmering
+    TextureParams params;
+    if (alpha)
+    {
+        params.Internal_Format = GL_RGBA;
+        params.Image_Format = GL_RGBA;
+    }
+    params.Mipmaps = true;
+    params.Filter_Min = GL_LINEAR_MIPMAP_LINEAR;
+    return params;
+}
+
+void ResourceManager::specifyTexture(Texture2D &texture, unsigned int width, unsigned int height, 
+                                        const unsigned char *data, const TextureParams &params)
+{
+    if (texture.ID == 0)
+        texture = TextureRegistry::Create(width, height, data, params);
+    else
+        TextureRegistry::Update(texture, width, height, data, params);
+}
+
+void ResourceManager::mapPixelBuffer(QueuedTexture &queued)
+{
+    // only the header is read here, the decode itself is left to the workers
+    int width, height, channels;
+    if (!stbi_info(queued.File.c_str(), &width, &height, &channels))
+        return;
+    queued.MappedSize = static_cast<size_t>(width) * height * (queued.Alpha ? 4 : 3);
+    glGenBuffers(1, &queued.PBO);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, queued.PBO);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, queued.MappedSize, nullptr, GL_STREAM_DRAW);
+    queued.Mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, queued.MappedSize, 
+                                                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+Texture2D ResourceManager::uploadTexture(const TextureParams &params, QueuedTexture &queued)
+{
+    Texture2D texture;
+    bool uploaded = false;
+    if (queued.PBO)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, queued.PBO);
+        // false if the buffer's contents were lost meanwhile, e.g. on a mode switch
+        bool intact = !queued.Mapped || glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        // with a pixel buffer bound the data pointer is an offset into it
+        if (queued.Buffered && intact)
         {
-            std::ifstream geometryShaderFile(gShaderFile);
-            std::stringstream gShaderStream;
-            gShaderStream << geometryShaderFile.rdbuf();
-            geometryShaderFile.close();
-            geometryCode = gShaderStream.str();
+            texture = TextureRegistry::Create(queued.Width, queued.Height, nullptr, params);
+            uploaded = true;
         }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        // freed by the driver once the copy is done
+        glDeleteBuffers(1, &queued.PBO);
+        queued.PBO = 0;
+        queued.Mapped = nullptr;
     }
-    catch (std::exception e)
+    if (!uploaded)
     {
-        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+        if (queued.Data == nullptr)
+            std::cout << "ERROR::TEXTURE: Failed to decode texture" << std::endl;
+        texture = TextureRegistry::Create(queued.Width, queued.Height, queued.Data, params);
     }
+    stbi_image_free(queued.Data);
+    queued.Data = nullptr;
+    return texture;
+}
+
+void ResourceManager::Clear()
+{    
+    // the names stay interned so IDs held by callers keep meaning the same resource after a reload, 
+    // acquiring a cleared texture loads it again
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (Shader &shader : Shaders)
+    {
+        glDeleteProgram(shader.ID);
+        shader.ID = 0;
+    }
+    for (unsigned int i = 0; i < Textures.size(); ++i)
+    {
+        setResident(i, false);
+        TextureRegistry::Destroy(Textures[i]);
+    }
+}
+
+Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, 
+                                            const char *defines, const std::string &name)
+{
+    // get vertex/fragment source code from filePath
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::string geometryCode;
+    // the pack is checked first, then the loose file
+    vertexCode = LoadShaderSource(vShaderFile);
+    fragmentCode = LoadShaderSource(fShaderFile);
+    if (gShaderFile != nullptr)
+        geometryCode = LoadShaderSource(gShaderFile);
     const char *vShaderCode = vertexCode.c_str();
     const char *fShaderCode = fragmentCode.c_str();
     const char *gShaderCode = geometryCode.c_str();
     
-    // create shader object from source code
+    // any change to a stage, the defines or the driver gives a new key
+    const char *driver[3] = { reinterpret_cast<const char*>(glGetString(GL_VENDOR)), 
+                                reinterpret_cast<const char*>(glGetString(GL_RENDERER)), 
+                                reinterpret_cast<const char*>(glGetString(GL_VERSION)) };
+    uint64_t key = HashBytes(vertexCode.data(), vertexCode.size());
+    key = HashBytes(fragmentCode.data(), fragmentCode.size(), key);
+    key = HashBytes(geometryCode.data(), geometryCode.size(), key);
+    if (defines != nullptr)
+        key = HashBytes(defines, std::strlen(defines), key);
+    for (const char *text : driver)
+        if (text != nullptr)
+            key = HashBytes(text, std::strlen(text), key);
+
     Shader shader;
-    shader.Compile(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
+    if (loadShaderBinary(name, key, shader))
+    {
+        ShaderCacheHits++;
+        return shader;
+    }
+    // create shader object from source code
+    ShaderCacheMisses++;
+    shader.CompileAsync(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr, defines);
+    pendingShaders.push_back({ name, key });
     return shader;
 }
 
-Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha)
+void ResourceManager::FinishShaders()
 {
-    // create texture object
-    Texture2D texture;
-    if (alpha)
+    for (const PendingShader &pending : pendingShaders)
+    {
+        Shader shader = GetShader(FindShader(pending.Name));
+        if (shader.Finish())
+            saveShaderBinary(pending.Name, pending.Key, shader);
+    }
+    pendingShaders.clear();
+}
+
+// fixed-size header in front of the driver's binary
+struct ShaderCacheHeader {
+    char     Magic[4];
+    uint32_t Format;
+    uint64_t Key;
+    uint32_t Length;
+    uint32_t Reserved;
+};
+
+std::string ResourceManager::shaderCachePath(const std::string &name)
+{
+    return "cache/shaders/" + name + ".bin";
+}
+
+bool ResourceManager::loadShaderBinary(const std::string &name, uint64_t key, Shader &shader)
+{
+    std::ifstream file(shaderCachePath(name), std::ios::binary);
+    ShaderCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (std::memcmp(header.Magic, "PRGB", 4) != 0 || header.Key != key)
+        return false;
+    std::vector<char> binary(header.Length);
+    if (!file.read(binary.data(), binary.size()))
+        return false;
+    return shader.LoadBinary(header.Format, binary.data(), binary.size());
+}
+
+void ResourceManager::saveShaderBinary(const std::string &name, uint64_t key, const Shader &shader)
+{
+    unsigned int format;
+    std::vector<char> binary;
+    if (!shader.GetBinary(format, binary))
+        return;
+
+    std::string path = shaderCachePath(name);
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
     {
-        texture.Internal_Format = GL_RGBA;
-        texture.Image_Format = GL_RGBA;
+        std::cout << "ERROR::SHADER: Could not write program cache " << path << std::endl;
+        return;
     }
+    ShaderCacheHeader header = { { 'P', 'R', 'G', 'B' }, format, key, static_cast<uint32_t>(binary.size()), 0 };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), binary.size());
+}
+
+void ResourceManager::loadTextureFromFile(const char *file, bool alpha, Texture2D &texture)
+{
+    // texture format
+    TextureParams params = textureParams(alpha);
 
     // load image
     int width, height, nrChannels;
     unsigned char* data = stbi_load(file, &width, &height, &nrChannels, 0);
 
     // now generate texture
-    texture.Generate(width, height, data);
+    specifyTexture(texture, width, height, data, params);
     
     // free image data
     stbi_image_free(data);
-    return texture;
 }
 
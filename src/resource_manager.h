@@ -1,39 +1,186 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <glad/glad.h>
 
 #include "texture.h"
 #include "shader.h"
+#include "asset_pack.h"
 
+class WorkerPool;
+
+// interned resource names, an index into the storage of their kind; stable for the whole run
+typedef unsigned int TextureID;
+typedef unsigned int ShaderID;
+
+// GPU memory of the managed textures and what keeping it under the budget cost
+struct TextureResidency {
+    size_t ResidentBytes, BudgetBytes;  // a budget of 0 keeps everything resident
+    unsigned int Resident;
+    unsigned int Evictions;
+    unsigned int ReloadStalls;          // acquires that had to load an evicted texture first
+    double StallMs;
+};
+
+// Loads and owns the textures and shaders. Names are interned to IDs when a resource is loaded, 
+// resolve them once with FindTexture/FindShader and look up by ID afterwards. Lookups may run 
+// on any thread, loading only on the one owning the GL context.
 class ResourceManager
 {
 public:
-    // Storage
-    static std::map<std::string, Shader> Shaders;
-    static std::map<std::string, Texture2D> Textures;
+    // Storage, indexed by ID
+    static std::vector<Shader> Shaders;
+    static std::vector<Texture2D> Textures;
+    // program binary cache lookups of this run, every miss was compiled from source
+    static unsigned int ShaderCacheHits, ShaderCacheMisses;
+    // preprocessed assets, looked up by source path before the loose file is read
+    static AssetPack Pack;
+    static TextureResidency Residency;
+
+    // maps the pack built by "make pack", false if there is none and loose files are used
+    static bool OpenPack(const char *file);
 
+    // restores the program from cache/shaders when its sources and the driver are unchanged, 
+    // otherwise starts compiling it; FinishShaders has to run before the shader is used.
+    // defines are inserted after the #version line of every stage, see Shader::Compile
     static Shader LoadShader(const char *vShaderFile, const char *fShaderFile, const char 
-                                *gShaderFile, std::string name);
+                                *gShaderFile, std::string name, const char *defines = nullptr);
 
-    static Shader GetShader(std::string name);
+    // reads a shader file (from the pack when it holds it), for owners that compile their own variants of it
+    static std::string LoadShaderSource(const char *file);
+    // reads a loose file, ignoring the pack
+    static std::string ReadFile(const char *file);
+
+    // the ID of a loaded shader, aborts on a name that was never loaded
+    static ShaderID FindShader(const std::string &name);
+    static Shader GetShader(ShaderID id);
+    static Shader GetShader(const std::string &name) { return GetShader(FindShader(name)); }
+
+    // Hot reloading: the shaders built from a file, a new program compiled from their loose files 
+    // without waiting (poll Ready on it), and the swap, which keeps the running program and returns 
+    // false when the new one failed to link. A swap keeps the program name, so every copy of the 
+    // Shader handed out earlier runs the new code.
+    static std::vector<ShaderID> ShadersUsing(const std::string &file);
+    static Shader RecompileShader(ShaderID id);
+    static bool ReplaceShader(ShaderID id, Shader &compiled);
+
+    // waits for the shaders compiled since the last call, reports their errors and stores their 
+    // binaries; loading every shader before finishing lets the driver compile them in parallel
+    static void FinishShaders();
 
     static Texture2D LoadTexture(const char *file, bool alpha, std::string name);
 
-    static Texture2D GetTexture(std::string name);
+    // the ID of a loaded texture, aborts on a name that was never loaded
+    static TextureID FindTexture(const std::string &name);
+    static Texture2D GetTexture(TextureID id);
+    static Texture2D GetTexture(const std::string &name) { return GetTexture(FindTexture(name)); }
+
+    // Textures nobody acquired are evicted least recently used first once the resident bytes exceed 
+    // the budget. An evicted texture keeps its ID and GL name but samples as black until it is 
+    // acquired again, which reloads it from the pack or its file on the spot.
+    static void SetTextureBudget(size_t bytes);
+    // respecifies every resident texture loaded from the file with new RGBA8 pixels, keeping their 
+    // names; returns how many there were
+    static unsigned int ReloadTexture(const std::string &file, const unsigned char *pixels, int width, int height);
+    // pins the texture until the matching release, reloading it first if it was evicted
+    static Texture2D AcquireTexture(TextureID id);
+    static void ReleaseTexture(TextureID id);
 
+    // adds a texture to the next LoadQueuedTextures
+    static void QueueTexture(const char *file, bool alpha, std::string name);
+    // decodes every queued texture concurrently on the pool (and the calling thread), uploading 
+    // each one through a pixel buffer as soon as its decode finished; logs the timeline
+    static void LoadQueuedTextures(WorkerPool *pool);
+
+    // deletes every texture and shader, their IDs stay reserved for a reload
     static void Clear();
 private:
 
     ResourceManager() { }
 
+    // name to ID tables; the mutex guards them and the storage, readers share it
+    static std::unordered_map<std::string, unsigned int> textureNames, shaderNames;
+    static std::shared_mutex mutex;
+    // the ID of the name, next if it is new; called with the mutex held exclusively
+    static unsigned int intern(std::unordered_map<std::string, unsigned int> &names, const std::string &name, 
+                                unsigned int next);
+    [[noreturn]] static void unknownResource(const char *kind, const std::string &name);
+
+    struct PendingShader {
+        std::string Name;
+        uint64_t Key;
+    };
+    static std::vector<PendingShader> pendingShaders;
+
+    // files and defines each shader was built from, indexed like Shaders
+    struct ShaderSource {
+        std::string Vertex, Fragment, Geometry;     // Geometry is empty without a geometry stage
+        std::string Defines;
+    };
+    static std::vector<ShaderSource> shaderSources;
+
     static Shader loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, 
-                                        const char *gShaderFile = nullptr);
+                                        const char *gShaderFile, const char *defines, const std::string &name);
+
+    // binary cache entry of a shader, keyed by a hash of its sources and the driver strings
+    static std::string shaderCachePath(const std::string &name);
+    static bool loadShaderBinary(const std::string &name, uint64_t key, Shader &shader);
+    static void saveShaderBinary(const std::string &name, uint64_t key, const Shader &shader);
+
+    // decode into the texture, generating it if the handle has no name yet
+    static void loadTextureFromFile(const char *file, bool alpha, Texture2D &texture);
+    // formats of a texture with or without alpha, mipmapped
+    static TextureParams textureParams(bool alpha);
+    static void specifyTexture(Texture2D &texture, unsigned int width, unsigned int height, 
+                                const unsigned char *data, const TextureParams &params);
+
+    // where a texture is reloaded from and its residency, indexed like Textures
+    struct TextureSource {
+        std::string File;
+        bool Alpha;
+        size_t Bytes;
+        unsigned int References;
+        uint64_t LastUse;
+        bool Resident;
+    };
+    static std::vector<TextureSource> textureSources;
+    static uint64_t useTick;
+    // the functions below are called with the mutex held exclusively
+    static void setResident(TextureID id, bool resident);
+    static void evictOverBudget();
+
+    struct QueuedTexture {
+        std::string File, Name;
+        bool Alpha;
+        // pixel buffer mapped by the main thread for the size the file header announces, 0 if it 
+        // couldn't be read
+        unsigned int PBO;
+        unsigned char *Mapped;
+        size_t MappedSize;
+        // filled in by the decoding thread; Data is left null once the pixels went into the buffer
+        unsigned char *Data;
+        bool Buffered;
+        int Width, Height;
+        double DecodeBegin, DecodeEnd;
+    };
+    static std::vector<QueuedTexture> queuedTextures;
 
-    static Texture2D loadTextureFromFile(const char *file, bool alpha);
+    // maps a pixel buffer the decoding thread can write the texture into
+    static void mapPixelBuffer(QueuedTexture &queued);
+    // creates the texture from the pixel buffer, the driver copies from it asynchronously, or 
+    // from the decoded pixels when they didn't go into it; frees both
+    static Texture2D uploadTexture(const TextureParams &params, QueuedTexture &queued);
+    // keeps the texture under its name, destroying the one it replaces
+    static void storeTexture(const std::string &name, const std::string &file, bool alpha, Texture2D texture);
+    // uploads a decoded texture straight from the pack mapping, false if the pack doesn't hold it
+    static bool loadTextureFromPack(const char *file, bool alpha, Texture2D &texture);
 };
 
 #endif
@@ -1,4 +1,6 @@
 #include "shader.h"
+#include "gl_extensions.h"
+#include <cstring>
 #include <iostream>
 
 Shader &Shader::Use()
@@ -7,33 +9,30 @@ Shader &Shader::Use()
     return *this;
 }
 
-void Shader::Compile(const char* vertexSource, const char* fragmentSource, const char* geometrySource)
+void Shader::Compile(const char* vertexSource, const char* fragmentSource, const char* geometrySource, 
+                        const char *defines)
 {
     unsigned int sVertex, sFragment, gShader;
     
     // vertex Shader
-    sVertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(sVertex, 1, &vertexSource, NULL);
-    glCompileShader(sVertex);
+    sVertex = this->compileStage(GL_VERTEX_SHADER, vertexSource, defines);
     checkCompileErrors(sVertex, "VERTEX");
     
     // fragment Shader
-    sFragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(sFragment, 1, &fragmentSource, NULL);
-    glCompileShader(sFragment);
+    sFragment = this->compileStage(GL_FRAGMENT_SHADER, fragmentSource, defines);
     checkCompileErrors(sFragment, "FRAGMENT");
     
     // if geometry shader source code is given, also compile geometry shader
     if (geometrySource != nullptr)
     {
-        gShader = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(gShader, 1, &geometrySource, NULL);
-        glCompileShader(gShader);
+        gShader = this->compileStage(GL_GEOMETRY_SHADER, geometrySource, defines);
         checkCompileErrors(gShader, "GEOMETRY");
     }
     
     // shader program
     this->ID = glCreateProgram();
+    if (GLExtensions::ProgramBinary)
+        GLExtensions::ProgramParameteri(this->ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glAttachShader(this->ID, sVertex);
     glAttachShader(this->ID, sFragment);
     if (geometrySource != nullptr)
@@ -48,6 +47,247 @@ void Shader::Compile(const char* vertexSource, const char* fragmentSource, const
         glDeleteShader(gShader);
 }
 
+void Shader::CompileAsync(const char *vertexSource, const char *fragmentSource, const char *geometrySource, 
+                            const char *defines)
+{
+    unsigned int sVertex = this->compileStage(GL_VERTEX_SHADER, vertexSource, defines);
+    unsigned int sFragment = this->compileStage(GL_FRAGMENT_SHADER, fragmentSource, defines);
+    unsigned int gShader = 0;
+    if (geometrySource != nullptr)
+        gShader = this->compileStage(GL_GEOMETRY_SHADER, geometrySource, defines);
+
+    // querying any status here would wait for the compiler, Finish reports the errors
+    this->ID = glCreateProgram();
+    if (GLExtensions::ProgramBinary)
+        GLExtensions::ProgramParameteri(this->ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(this->ID, sVertex);
+    glAttachShader(this->ID, sFragment);
+    if (geometrySource != nullptr)
+        glAttachShader(this->ID, gShader);
+    glLinkProgram(this->ID);
+
+    // only flagged for deletion, they are freed together with the program
+    glDeleteShader(sVertex);
+    glDeleteShader(sFragment);
+    if (geometrySource != nullptr)
+        glDeleteShader(gShader);
+}
+
+bool Shader::LoadBinary(unsigned int format, const void *binary, int length)
+{
+    if (!GLExtensions::ProgramBinary)
+        return false;
+    this->ID = glCreateProgram();
+    GLExtensions::LoadProgramBinary(this->ID, format, binary, length);
+    int success;
+    glGetProgramiv(this->ID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(this->ID);
+        this->ID = 0;
+    }
+    return success;
+}
+
+bool Shader::GetBinary(unsigned int &format, std::vector<char> &binary) const
+{
+    if (!GLExtensions::ProgramBinary)
+        return false;
+    int length = 0;
+    glGetProgramiv(this->ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    binary.resize(length);
+    GLenum binaryFormat;
+    GLExtensions::GetProgramBinary(this->ID, length, &length, &binaryFormat, binary.data());
+    binary.resize(length);
+    format = binaryFormat;
+    return length > 0;
+}
+
+bool Shader::Linked() const
+{
+    int success;
+    glGetProgramiv(this->ID, GL_LINK_STATUS, &success);
+    return success;
+}
+
+void Shader::Replace(Shader &compiled)
+{
+    std::vector<UniformValue> values = this->saveUniforms();
+    // loading a binary doesn't compile anything, it only copies the executable
+    unsigned int format;
+    std::vector<char> binary;
+    bool loaded = false;
+    if (compiled.GetBinary(format, binary))
+    {
+        GLExtensions::LoadProgramBinary(this->ID, format, binary.data(), binary.size());
+        loaded = this->Linked();
+    }
+    if (!loaded)
+    {
+        // the stages are compiled already, only the link is redone; the old ones were flagged for 
+        // deletion and are freed once detached
+        GLuint stages[3];
+        GLsizei count;
+        glGetAttachedShaders(this->ID, 3, &count, stages);
+        for (GLsizei i = 0; i < count; ++i)
+            glDetachShader(this->ID, stages[i]);
+        glGetAttachedShaders(compiled.ID, 3, &count, stages);
+        for (GLsizei i = 0; i < count; ++i)
+            glAttachShader(this->ID, stages[i]);
+        glLinkProgram(this->ID);
+    }
+    glDeleteProgram(compiled.ID);
+    compiled.ID = 0;
+    this->restoreUniforms(values);
+}
+
+// components of a uniform type the program state can be saved for, 0 for anything else
+static unsigned int uniformComponents(GLenum type, bool &integer)
+{
+    integer = false;
+    switch (type)
+    {
+        case GL_FLOAT:          return 1;
+        case GL_FLOAT_VEC2:     return 2;
+        case GL_FLOAT_VEC3:     return 3;
+        case GL_FLOAT_VEC4:     return 4;
+        case GL_FLOAT_MAT2:     return 4;
+        case GL_FLOAT_MAT3:     return 9;
+        case GL_FLOAT_MAT4:     return 16;
+    }
+    integer = true;
+    switch (type)
+    {
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_2D_MULTISAMPLE: return 1;
+        case GL_INT_VEC2:               return 2;
+        case GL_INT_VEC3:               return 3;
+        case GL_INT_VEC4:               return 4;
+    }
+    return 0;
+}
+
+std::vector<Shader::UniformValue> Shader::saveUniforms() const
+{
+    std::vector<UniformValue> values;
+    int count = 0;
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &count);
+    for (int i = 0; i < count; ++i)
+    {
+        char name[256];
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(this->ID, i, sizeof(name), &length, &size, &type, name);
+        bool integer;
+        if (uniformComponents(type, integer) == 0)
+            continue;
+        // arrays are reported as "name[0]", every element has its own location
+        std::string base(name, length);
+        if (size > 1 && base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+            base.resize(base.size() - 3);
+        for (GLint element = 0; element < size; ++element)
+        {
+            UniformValue value;
+            value.Name = size > 1 ? base + "[" + std::to_string(element) + "]" : base;
+            value.Type = type;
+            int location = glGetUniformLocation(this->ID, value.Name.c_str());
+            if (location < 0)
+                continue;
+            if (integer)
+                glGetUniformiv(this->ID, location, value.Ints);
+            else
+                glGetUniformfv(this->ID, location, value.Floats);
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+void Shader::restoreUniforms(const std::vector<UniformValue> &values)
+{
+    // the render queue tracks the bound program, leave it as it was
+    GLint current;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    glUseProgram(this->ID);
+    for (const UniformValue &value : values)
+    {
+        int location = glGetUniformLocation(this->ID, value.Name.c_str());
+        if (location < 0)
+            continue;
+        bool integer;
+        unsigned int components = uniformComponents(value.Type, integer);
+        if (value.Type == GL_FLOAT_MAT2)
+            glUniformMatrix2fv(location, 1, GL_FALSE, value.Floats);
+        else if (value.Type == GL_FLOAT_MAT3)
+            glUniformMatrix3fv(location, 1, GL_FALSE, value.Floats);
+        else if (value.Type == GL_FLOAT_MAT4)
+            glUniformMatrix4fv(location, 1, GL_FALSE, value.Floats);
+        else if (integer)
+        {
+            if (components == 1) glUniform1iv(location, 1, value.Ints);
+            else if (components == 2) glUniform2iv(location, 1, value.Ints);
+            else if (components == 3) glUniform3iv(location, 1, value.Ints);
+            else glUniform4iv(location, 1, value.Ints);
+        }
+        else
+        {
+            if (components == 1) glUniform1fv(location, 1, value.Floats);
+            else if (components == 2) glUniform2fv(location, 1, value.Floats);
+            else if (components == 3) glUniform3fv(location, 1, value.Floats);
+            else glUniform4fv(location, 1, value.Floats);
+        }
+    }
+    glUseProgram(current);
+}
+
+bool Shader::Ready() const
+{
+    if (!GLExtensions::ParallelShaderCompile)
+        return true;
+    int done;
+    glGetProgramiv(this->ID, GL_COMPLETION_STATUS_KHR, &done);
+    return done;
+}
+
+bool Shader::Finish()
+{
+    // the stages stay attached until the program is deleted, their logs tell which one failed
+    GLuint stages[3];
+    GLsizei count;
+    glGetAttachedShaders(this->ID, 3, &count, stages);
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        int type;
+        glGetShaderiv(stages[i], GL_SHADER_TYPE, &type);
+        checkCompileErrors(stages[i], type == GL_VERTEX_SHADER ? "VERTEX" : type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "GEOMETRY");
+    }
+    checkCompileErrors(this->ID, "PROGRAM");
+    return this->Linked();
+}
+
+unsigned int Shader::compileStage(GLenum type, const char *source, const char *defines)
+{
+    // everything up to and including the #version line, then the defines, then the rest
+    const char *body = source;
+    if (defines != nullptr && std::strncmp(source, "#version", 8) == 0)
+    {
+        const char *newline = std::strchr(source, '\n');
+        body = newline ? newline + 1 : source + std::strlen(source);
+    }
+    const char *parts[3] = { source, defines != nullptr ? defines : "", body };
+    int lengths[3] = { static_cast<int>(body - source), -1, -1 };
+
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 3, parts, lengths);
+    glCompileShader(shader);
+    return shader;
+}
+
 void Shader::SetFloat(const char *name, float value, bool useShader)
 {
     if (useShader)
@@ -2,6 +2,7 @@
 #define SHADER_H
 
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -19,9 +20,32 @@ public:
     // sets the current shader as active
     Shader &Use();
     
-    // compiles from given source code
+    // compiles from given source code, defines (e.g. "#define A\n#define B\n") are inserted
+    // right after the #version line of every stage
     void Compile(const char *vertexSource, const char *fragmentSource, 
-                    const char *geometrySource = nullptr); // note: geometry source code is optional 
+                    const char *geometrySource = nullptr, const char *defines = nullptr); // note: geometry source code is optional 
+    // issues the compile and link without waiting for them, poll Ready and call Finish before use
+    void CompileAsync(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr, 
+                        const char *defines = nullptr);
+    // true once the driver finished the program; without parallel compile support it always is, 
+    // and Finish waits instead
+    bool Ready() const;
+    // reports the compile errors of every stage and the link errors of an asynchronous compile, 
+    // false if the program didn't link
+    bool Finish();
+
+    // creates the program from a binary of GetBinary, false if the driver rejects it (e.g. after 
+    // a driver update), the shader is left without a program then
+    bool LoadBinary(unsigned int format, const void *binary, int length);
+    // the linked program as a driver specific binary, false when program binaries are unsupported
+    bool GetBinary(unsigned int &format, std::vector<char> &binary) const;
+
+    // whether the last link succeeded, waits for an asynchronous compile
+    bool Linked() const;
+    // moves the executable of a linked program into this one and deletes it: the program name 
+    // (so every copy of this Shader) and the values of uniforms both have are kept. Goes through 
+    // a program binary when supported, otherwise relinks with the other program's stages
+    void Replace(Shader &compiled);
     
     // utility
     void SetFloat (const char *name, float value, bool useShader = false);
@@ -34,6 +58,17 @@ public:
     void SetVector4f (const char *name, const glm::vec4 &value, bool useShader = false);
     void SetMatrix4 (const char *name, const glm::mat4 &matrix, bool useShader = false);
 private:
+    // values of the active uniforms, to carry them over a relink
+    struct UniformValue {
+        std::string Name;
+        unsigned int Type;
+        float Floats[16];
+        int Ints[4];
+    };
+    std::vector<UniformValue> saveUniforms() const;
+    void restoreUniforms(const std::vector<UniformValue> &values);
+
+    unsigned int compileStage(GLenum type, const char *source, const char *defines);
     // checks if compilation or linking failed and prints the error logs
     void checkCompileErrors(unsigned int object, std::string type); 
 };
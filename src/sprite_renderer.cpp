@@ -1,21 +1,27 @@
 #include "sprite_renderer.h"
 
+#include <algorithm>
+#include <cstdint>
 
-SpriteRenderer::SpriteRenderer(Shader &shader)
+
+SpriteRenderer::SpriteRenderer(Shader &shader, Shader &batchShader, StreamBuffer &stream)
 {
     this->shader = shader;
+    this->batchShader = batchShader;
+    this->stream = &stream;
     this->initRenderData();
 }
 
 SpriteRenderer::~SpriteRenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    glDeleteVertexArrays(1, &this->batchVAO);
+    glDeleteBuffers(1, &this->quadVBO);
 }
 
 void SpriteRenderer::initRenderData()
 {
     // configure VAO/VBO
-    unsigned int VBO;
     float vertices[] = { 
         // pos      tex
         0.0f, 1.0f, 0.0f, 1.0f,
@@ -28,14 +34,26 @@ void SpriteRenderer::initRenderData()
     };
 
     glGenVertexArrays(1, &this->quadVAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glBindVertexArray(this->quadVAO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+    // batched sprites share the quad and read <rect, color + rotation> per instance from 
+    // the stream buffer, pointed at each batch's upload when it is drawn
+    glGenVertexArrays(1, &this->batchVAO);
+    glBindVertexArray(this->batchVAO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
@@ -70,3 +88,33 @@ void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec
 }
 
 
+
+void SpriteRenderer::SubmitSprite(RenderQueue &queue, RenderLayer layer, Texture2D &texture, glm::vec2 position, 
+                                    glm::vec2 size, float rotate, glm::vec3 color)
+{
+    RenderCommand &command = queue.Submit(layer, BLEND_ALPHA, this->batchShader.ID, texture.ID, 
+                                            &SpriteRenderer::executeBatch, this);
+    // stored in the instance layout: <position, size>, <color, rotation>
+    float instance[8] = { position.x, position.y, size.x, size.y, 
+                            color.x, color.y, color.z, glm::radians(rotate) };
+    std::copy(instance, instance + 8, command.Data);
+}
+
+void SpriteRenderer::executeBatch(void *owner, const RenderCommand *commands, unsigned int count)
+{
+    SpriteRenderer *renderer = static_cast<SpriteRenderer*>(owner);
+    renderer->instanceData.clear();
+    for (unsigned int i = 0; i < count; ++i)
+        renderer->instanceData.insert(renderer->instanceData.end(), commands[i].Data, commands[i].Data + 8);
+
+    unsigned int offset = renderer->stream->Upload(renderer->instanceData.data(), 
+                                                    sizeof(float) * renderer->instanceData.size());
+
+    glBindVertexArray(renderer->batchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->stream->ID);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(uintptr_t)offset);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(uintptr_t)(offset + 4 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+    glBindVertexArray(0);
+}
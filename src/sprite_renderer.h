@@ -1,5 +1,6 @@
 #ifndef SPRITE_RENDERER_H
 #define SPRITE_RENDERER_H
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -7,26 +8,38 @@
 
 #include "texture.h"
 #include "shader.h"
+#include "render_queue.h"
+#include "stream_buffer.h"
 
 
 class SpriteRenderer
 {
 public:
-    SpriteRenderer(Shader &shader);
+    SpriteRenderer(Shader &shader, Shader &batchShader, StreamBuffer &stream);
     ~SpriteRenderer();
     
     // renders a defined quad textured given the sprite
     void DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), 
                         float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f));
 
+    // queues a sprite, consecutive sprites sharing a texture are drawn with one instanced call
+    void SubmitSprite(RenderQueue &queue, RenderLayer layer, Texture2D &texture, glm::vec2 position, 
+                        glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, 
+                        glm::vec3 color = glm::vec3(1.0f));
+
 private:
     // Render state
     Shader shader; 
-    unsigned int quadVAO;
+    Shader batchShader;
+    unsigned int quadVAO, quadVBO;
+    unsigned int batchVAO;
+    StreamBuffer *stream;
+    std::vector<float> instanceData;
     
     // Initializes and configures the quad's buffer and vertex attributes
     void initRenderData();
+
+    static void executeBatch(void *owner, const RenderCommand *commands, unsigned int count);
 };
 
 #endif
-
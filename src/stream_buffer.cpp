@@ -0,0 +1,99 @@
+#include "stream_buffer.h"
+
+#include <cstring>
+
+// offsets stay aligned for any vertex attribute type
+const unsigned int ALIGNMENT = 16;
+
+
+StreamBuffer::StreamBuffer(unsigned int regionSize)
+    : Orphans(0), regionSize(regionSize), region(0), head(0), regionChecked(false), fences()
+{
+    glGenBuffers(1, &this->ID);
+    glBindBuffer(GL_ARRAY_BUFFER, this->ID);
+    glBufferData(GL_ARRAY_BUFFER, this->regionSize * REGIONS, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (GLsync &fence : this->fences)
+        if (fence)
+            glDeleteSync(fence);
+    glDeleteBuffers(1, &this->ID);
+}
+
+unsigned int StreamBuffer::Upload(const void *data, unsigned int size)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, this->ID);
+
+    // the region is only reused once the frame that last wrote it has been consumed
+    if (!this->regionChecked)
+    {
+        GLsync &fence = this->fences[this->region];
+        if (fence)
+        {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                this->orphan(this->regionSize);
+            else
+            {
+                glDeleteSync(fence);
+                fence = 0;
+            }
+        }
+        this->regionChecked = true;
+    }
+
+    if (this->head + size > this->regionSize)
+    {
+        // grow so the whole frame fits in one region again, previous uploads of this
+        // frame keep their old storage alive until their draws are done
+        unsigned int required = this->head + size;
+        unsigned int newSize = this->regionSize;
+        while (newSize < required)
+            newSize *= 2;
+        this->orphan(newSize);
+    }
+
+    unsigned int offset = this->region * this->regionSize + this->head;
+    void *target = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, 
+                        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (target)
+    {
+        std::memcpy(target, data, size);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    else
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    this->head += (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    return offset;
+}
+
+void StreamBuffer::EndFrame()
+{
+    if (this->head > 0)
+    {
+        if (this->fences[this->region])
+            glDeleteSync(this->fences[this->region]);
+        this->fences[this->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    this->region = (this->region + 1) % REGIONS;
+    this->head = 0;
+    this->regionChecked = false;
+}
+
+void StreamBuffer::orphan(unsigned int newRegionSize)
+{
+    this->regionSize = newRegionSize;
+    glBufferData(GL_ARRAY_BUFFER, this->regionSize * REGIONS, NULL, GL_STREAM_DRAW);
+    for (GLsync &fence : this->fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = 0;
+    }
+    this->head = 0;
+    ++this->Orphans;
+}
@@ -0,0 +1,38 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+// Ring of per-frame regions inside one vertex buffer for dynamic uploads. Each frame 
+// writes into its own region through an unsynchronized mapping and fences it once the 
+// frame's draws are issued, so uploads never wait on draws that are still in flight. 
+// If the GPU falls behind by more than the ring, the storage is orphaned instead of waited on.
+class StreamBuffer
+{
+public:
+    static const unsigned int REGIONS = 3;
+
+    unsigned int ID;
+    // number of times the storage was orphaned, because a region was still busy or too small
+    unsigned int Orphans;
+
+    StreamBuffer(unsigned int regionSize);
+    ~StreamBuffer();
+
+    // copies data into the current frame's region and returns its byte offset in the buffer
+    unsigned int Upload(const void *data, unsigned int size);
+
+    // fences the current region and moves on to the next one, called once per frame after the draws
+    void EndFrame();
+
+private:
+    unsigned int regionSize;
+    unsigned int region, head;
+    bool regionChecked;
+    GLsync fences[REGIONS];
+
+    // replaces the storage, optionally growing it, and drops every fence
+    void orphan(unsigned int newRegionSize);
+};
+
+#endif
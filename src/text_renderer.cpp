@@ -1,140 +1,626 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 
 #include <glm/gtc/matrix_transform.hpp>
-#include <ft2build.h>
-#include FT_FREETYPE_H
 
 #include "text_renderer.h"
 #include "resource_manager.h"
+#include "hash.h"
 
+// fixed-size part of a serialized glyph, followed by Size[0] * Size[1] bytes of distance field
+struct GlyphRecord {
+    uint32_t Code;
+    int32_t  Size[2];
+    int32_t  Bearing[2];
+    int32_t  Advance;
+};
 
-TextRenderer::TextRenderer(unsigned int width, unsigned int height)
+// bytes the whole record starting with this fixed part takes, 0 if that's more than size
+static size_t glyphRecordLength(const GlyphRecord &record, size_t size)
 {
-    this->TextShader = ResourceManager::LoadShader("shaders/text_2d.vs", "shaders/text_2d.fs", nullptr, "text");
+    size_t pixels = static_cast<size_t>(record.Size[0]) * record.Size[1];
+    if (size < sizeof(record) || record.Size[0] < 0 || record.Size[1] < 0 || size - sizeof(record) < pixels)
+        return 0;
+    return sizeof(record) + pixels;
+}
+
+TextRenderer::TextRenderer(unsigned int width, unsigned int height, StreamBuffer &stream)
+    : stream(&stream), queuedFrame(0), queuedGlyphs(0), built(false), capHeight(0.0f), glyphScale(1.0f), 
+        ft(nullptr), face(nullptr), useTick(0), frameTick(0), generation(0), packedEnd(nullptr), cacheEnd(0)
+{
+    this->TextShader = ResourceManager::GetShader("text");
     this->TextShader.SetMatrix4("projection", glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f), true);
     this->TextShader.SetInteger("text", 0);
 
-    // configure VAO/VBO for texture quads
+    // configure VAO for texture quads, the vertices themselves live in the stream buffer
     glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &this->VBO);
     glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnableVertexAttribArray(1);
     glBindVertexArray(0);
 }
 
+TextRenderer::~TextRenderer()
+{
+    if (this->face)
+        FT_Done_Face(this->face);
+    if (this->ft)
+        FT_Done_FreeType(this->ft);
+}
+
 void TextRenderer::Load(std::string font, unsigned int fontSize)
 {
-    this->Characters.clear();
+    this->glyphScale = fontSize / static_cast<float>(SDF_GLYPH_SIZE);
+    this->packedGlyphs.clear();
+    this->cachedGlyphs.clear();
+    this->cacheFile.close();
+
+    // the distance fields only depend on the font and the SDF size, never on the size text is drawn at
+    std::string name = font.substr(font.find_last_of("/\\") + 1);
+    this->cachePath = "cache/" + name + "_" + std::to_string(SDF_GLYPH_SIZE) + ".sdf";
+
+    // an asset pack holds the printable ASCII glyphs already rasterized, the font itself is then 
+    // only opened once a glyph outside of them is drawn
+    const PackEntry *packed = ResourceManager::Pack.Find(font, PACK_GLYPHS);
+    if (packed && this->readPackedGlyphs(ResourceManager::Pack.Data(*packed), packed->Size))
+        this->fontPath = font;
+    else
+        this->openFont(font);
+
+    // one fixed page, slots are filled and evicted as glyphs are used
+    this->slots.assign(GLYPH_SLOTS, GlyphSlot());
+    this->asciiSlots.fill(-1);
+    this->slotOfCode.clear();
+    this->GlyphStats = GlyphCacheStats();
+    this->generation++;
+
+    // disable byte-alignment restriction
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); 
+    TextureParams params;
+    params.Internal_Format = GL_RED;
+    params.Image_Format = GL_RED;
+    params.Wrap_S = GL_CLAMP_TO_EDGE;
+    params.Wrap_T = GL_CLAMP_TO_EDGE;
+    TextureRegistry::Destroy(this->Atlas);
+    this->Atlas = TextureRegistry::Create(GLYPH_PAGE_SIZE, GLYPH_PAGE_SIZE, nullptr, params);
+}
+
+int TextRenderer::acquire(uint32_t code)
+{
+    int slot = this->findSlot(code);
+    if (slot >= 0)
+    {
+        this->GlyphStats.Hits++;
+        this->slots[slot].LastUse = ++this->useTick;
+        return slot;
+    }
+    this->GlyphStats.Misses++;
+
+    // a free slot, otherwise the least recently used one that this frame's text doesn't reference
+    for (unsigned int i = 0; i < this->slots.size() && slot < 0; ++i)
+        if (!this->slots[i].Occupied)
+            slot = i;
+    if (slot < 0)
+    {
+        for (unsigned int i = 0; i < this->slots.size(); ++i)
+            if (this->slots[i].LastUse <= this->frameTick && (slot < 0 || this->slots[i].LastUse < this->slots[slot].LastUse))
+                slot = i;
+        if (slot < 0)
+            return -1;
+        uint32_t evicted = this->slots[slot].Code;
+        if (evicted < 128)
+            this->asciiSlots[evicted] = -1;
+        else
+            this->slotOfCode.erase(evicted);
+        this->GlyphStats.Evictions++;
+        this->GlyphStats.Resident--;
+    }
+
+    GlyphBitmap bitmap;
+    if (!this->fetchGlyph(code, bitmap))
+        std::cout << "ERROR::FREETYTPE: Failed to load Glyph " << code << std::endl;
+    if (bitmap.Size.x > static_cast<int>(GLYPH_SLOT_SIZE) - 2 || bitmap.Size.y > static_cast<int>(GLYPH_SLOT_SIZE) - 2)
+    {
+        std::cout << "ERROR::TEXTRENDERER: Glyph " << code << " does not fit an atlas slot" << std::endl;
+        bitmap.Size = glm::ivec2(0);
+    }
+
+    // the whole slot is rewritten so the glyph keeps a blank border against its neighbours
+    unsigned int columns = GLYPH_PAGE_SIZE / GLYPH_SLOT_SIZE;
+    glm::ivec2 origin(slot % columns * GLYPH_SLOT_SIZE, slot / columns * GLYPH_SLOT_SIZE);
+    this->slotPixels.assign(GLYPH_SLOT_SIZE * GLYPH_SLOT_SIZE, 0);
+    for (int row = 0; row < bitmap.Size.y; ++row)
+        std::copy(bitmap.Pixels.begin() + row * bitmap.Size.x, bitmap.Pixels.begin() + (row + 1) * bitmap.Size.x, 
+                    this->slotPixels.begin() + (row + 1) * GLYPH_SLOT_SIZE + 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    this->Atlas.Bind();
+    glTexSubImage2D(GL_TEXTURE_2D, 0, origin.x, origin.y, GLYPH_SLOT_SIZE, GLYPH_SLOT_SIZE, GL_RED, 
+                    GL_UNSIGNED_BYTE, this->slotPixels.data());
+
+    GlyphSlot &entry = this->slots[slot];
+    entry.Code = code;
+    entry.Occupied = true;
+    entry.LastUse = ++this->useTick;
+    entry.Glyph.Size = bitmap.Size;
+    entry.Glyph.Bearing = bitmap.Bearing;
+    entry.Glyph.Advance = bitmap.Advance;
+    entry.Glyph.UVMin = glm::vec2(origin + 1) / static_cast<float>(GLYPH_PAGE_SIZE);
+    entry.Glyph.UVMax = glm::vec2(origin + 1 + bitmap.Size) / static_cast<float>(GLYPH_PAGE_SIZE);
+    if (code < 128)
+        this->asciiSlots[code] = slot;
+    else
+        this->slotOfCode[code] = slot;
+    this->GlyphStats.Resident++;
+    // glyph runs cached by labels may point at the slot's previous glyph or lack this one
+    this->generation++;
+    return slot;
+}
+
+unsigned int TextRenderer::acquireString(const char *text, unsigned int length)
+{
+    unsigned int glyphs = 0;
+    for (const char *p = text, *end = text + length; p < end; ++glyphs)
+        this->acquire(NextCodePoint(p, end));
+    return glyphs;
+}
+
+int TextRenderer::findSlot(uint32_t code) const
+{
+    if (code < 128)
+        return this->asciiSlots[code];
+    auto it = this->slotOfCode.find(code);
+    return it != this->slotOfCode.end() ? it->second : -1;
+}
+
+void TextRenderer::openFont(std::string font)
+{
+    this->fontPath.clear();
+
+    // FreeType reads the face from memory, so the font data stays alive with the renderer
+    std::ifstream fontFile(font, std::ios::binary);
+    this->fontData.assign(std::istreambuf_iterator<char>(fontFile), std::istreambuf_iterator<char>());
+    if (this->fontData.empty())
+        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+
     // initialize and load FreeType library
-    FT_Library ft;    
-    if (FT_Init_FreeType(&ft)) // all functions return a value different than 0 whenever an error occurred
+    if (FT_Init_FreeType(&this->ft)) // all functions return a value different than 0 whenever an error occurred
+    {
         std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-    
-    FT_Face face;
-    if (FT_New_Face(ft, font.c_str(), 0, &face))
+        this->ft = nullptr;
+    }
+#ifdef HAVE_FT_SDF
+    int spread = SDF_SPREAD;
+    if (this->ft)
+        FT_Property_Set(this->ft, "sdf", "spread", &spread);
+#endif
+    if (!this->ft || FT_New_Memory_Face(this->ft, this->fontData.data(), this->fontData.size(), 0, &this->face))
+    {
         std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
-    
-    // size to load glyphs as
-    FT_Set_Pixel_Sizes(face, 0, fontSize);
-    
-    // disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); 
-    
-    // for the first 128 ASCII characters, pre-load/compile their characters and store
-    for (GLubyte c = 0; c < 128; c++)
+        this->face = nullptr;
+    }
+
+    // size to load glyphs as, no glyph is rasterized until it is first drawn
+    if (this->face)
+    {
+        FT_Set_Pixel_Sizes(this->face, 0, SDF_GLYPH_SIZE);
+        this->capHeight = GlyphCapHeight(this->face);
+    }
+    this->openCache(HashBytes(this->fontData.data(), this->fontData.size()));
+}
+
+bool TextRenderer::readPackedGlyphs(const unsigned char *data, size_t size)
+{
+    PackGlyphHeader header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.GlyphSize != SDF_GLYPH_SIZE || header.Spread != SDF_SPREAD)
+        return false;
+    this->capHeight = header.CapHeight;
+
+    // the pack stays mapped, records are only located here and decoded on an atlas miss
+    const char *record = reinterpret_cast<const char*>(data) + sizeof(header);
+    this->packedEnd = reinterpret_cast<const char*>(data) + size;
+    for (unsigned int i = 0; i < header.Count; ++i)
     {
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+        GlyphRecord fixed;
+        if (this->packedEnd - record < static_cast<ptrdiff_t>(sizeof(fixed)))
+            break;
+        std::memcpy(&fixed, record, sizeof(fixed));
+        size_t length = glyphRecordLength(fixed, this->packedEnd - record);
+        if (length == 0)
+            break;
+        this->packedGlyphs[fixed.Code] = record;
+        record += length;
+    }
+    return true;
+}
+
+bool TextRenderer::fetchGlyph(uint32_t code, GlyphBitmap &bitmap)
+{
+    if (!this->fontPath.empty() && this->packedGlyphs.count(code) == 0)
+        this->openFont(this->fontPath);
+    uint32_t stored;
+    auto packed = this->packedGlyphs.find(code);
+    if (packed != this->packedGlyphs.end() && ReadGlyphRecord(packed->second, this->packedEnd - packed->second, stored, bitmap))
+        return true;
+    auto cached = this->cachedGlyphs.find(code);
+    if (cached != this->cachedGlyphs.end() && this->readCachedGlyph(cached->second, bitmap))
+        return true;
+    if (!this->face || !RasterizeGlyph(this->face, code, bitmap))
+        return false;
+    this->appendCache(code, bitmap);
+    return true;
+}
+
+// fixed-size records so the cache does not depend on struct padding
+struct SdfCacheHeader {
+    char     Magic[4];
+    uint32_t Version;
+    uint64_t FontHash;
+    uint32_t GlyphSize;
+    uint32_t Spread;
+};
+
+const uint32_t SDF_CACHE_VERSION = 2;
+
+void TextRenderer::openCache(uint64_t fontHash)
+{
+    SdfCacheHeader expected = { { 'S', 'D', 'F', 'G' }, SDF_CACHE_VERSION, fontHash, SDF_GLYPH_SIZE, SDF_SPREAD };
+
+    this->cachedGlyphs.clear();
+    this->cacheFile.close();
+    this->cacheFile.clear();
+    this->cacheFile.open(this->cachePath, std::ios::binary);
+    SdfCacheHeader header;
+    std::error_code error;
+    if (this->cacheFile.read(reinterpret_cast<char*>(&header), sizeof(header)) && 
+        std::memcmp(&header, &expected, sizeof(header)) == 0)
+    {
+        // only the fixed part of each record is read, skipping over the pixels
+        uint64_t size = std::filesystem::file_size(this->cachePath, error);
+        uint64_t offset = sizeof(header);
+        GlyphRecord record;
+        while (!error && this->cacheFile.seekg(offset) && this->cacheFile.read(reinterpret_cast<char*>(&record), sizeof(record)))
         {
-            std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-            continue;
+            size_t length = glyphRecordLength(record, size - offset);
+            if (length == 0)
+                break;
+            this->cachedGlyphs[record.Code] = offset;
+            offset += length;
         }
+        this->cacheFile.clear();
+        // glyphs are appended as they are first rasterized, a torn last record is cut off so the 
+        // next one is appended where the index expects it
+        if (!error && offset < size)
+            std::filesystem::resize_file(this->cachePath, offset, error);
+        this->cacheEnd = offset;
+        return;
+    }
 
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-            );
-        
-        // texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-       
-        // character storage
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            face->glyph->advance.x
-        };
-        Characters.insert(std::pair<char, Character>(c, character));
+    // any mismatch starts the cache over
+    this->cacheFile.close();
+    std::filesystem::create_directories(std::filesystem::path(this->cachePath).parent_path(), error);
+    std::ofstream out(this->cachePath, std::ios::binary | std::ios::trunc);
+    if (!out)
+        std::cout << "ERROR::TEXTRENDERER: Could not write glyph cache " << this->cachePath << std::endl;
+    out.write(reinterpret_cast<const char*>(&expected), sizeof(expected));
+    out.close();
+    this->cacheEnd = sizeof(expected);
+    this->cacheFile.clear();
+    this->cacheFile.open(this->cachePath, std::ios::binary);
+}
+
+bool TextRenderer::readCachedGlyph(uint64_t offset, GlyphBitmap &bitmap)
+{
+    GlyphRecord record;
+    this->cacheFile.clear();
+    if (!this->cacheFile.seekg(offset) || !this->cacheFile.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        return false;
+    std::vector<char> data(sizeof(record) + static_cast<size_t>(record.Size[0]) * record.Size[1]);
+    std::memcpy(data.data(), &record, sizeof(record));
+    uint32_t code;
+    return this->cacheFile.read(data.data() + sizeof(record), data.size() - sizeof(record)) && 
+        ReadGlyphRecord(data.data(), data.size(), code, bitmap) != 0;
+}
+
+void TextRenderer::appendCache(uint32_t code, const GlyphBitmap &bitmap)
+{
+    std::ofstream file(this->cachePath, std::ios::binary | std::ios::app);
+    if (!file)
+        return;
+    std::vector<char> record;
+    WriteGlyphRecord(record, code, bitmap);
+    // indexed once it is on disk, a failed write only means rasterizing the glyph again next time
+    if (file.write(record.data(), record.size()).flush())
+    {
+        this->cachedGlyphs[code] = this->cacheEnd;
+        this->cacheEnd += record.size();
+    }
+}
+
+void WriteGlyphRecord(std::vector<char> &out, uint32_t code, const GlyphBitmap &glyph)
+{
+    GlyphRecord record = { code, { glyph.Size.x, glyph.Size.y }, { glyph.Bearing.x, glyph.Bearing.y }, 
+                            static_cast<int32_t>(glyph.Advance) };
+    const char *bytes = reinterpret_cast<const char*>(&record);
+    out.insert(out.end(), bytes, bytes + sizeof(record));
+    out.insert(out.end(), glyph.Pixels.begin(), glyph.Pixels.end());
+}
+
+size_t ReadGlyphRecord(const char *data, size_t size, uint32_t &code, GlyphBitmap &glyph)
+{
+    GlyphRecord record;
+    if (size < sizeof(record))
+        return 0;
+    std::memcpy(&record, data, sizeof(record));
+    size_t length = glyphRecordLength(record, size);
+    if (length == 0)
+        return 0;
+    code = record.Code;
+    glyph.Size = glm::ivec2(record.Size[0], record.Size[1]);
+    glyph.Bearing = glm::ivec2(record.Bearing[0], record.Bearing[1]);
+    glyph.Advance = record.Advance;
+    glyph.Pixels.assign(data + sizeof(record), data + length);
+    return length;
+}
+
+int GlyphCapHeight(FT_Face face)
+{
+    // top of 'H' from its outline metrics, the distance field adds the spread above it
+    if (FT_Load_Char(face, 'H', FT_LOAD_DEFAULT))
+        return 0;
+    return (face->glyph->metrics.horiBearingY >> 6) + SDF_SPREAD;
+}
+
+uint32_t NextCodePoint(const char *&text, const char *end)
+{
+    unsigned char lead = static_cast<unsigned char>(*text++);
+    if (lead < 0x80)
+        return lead;
+    // number of continuation bytes announced by the lead byte
+    int extra = lead >= 0xF8 ? -1 : lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+    if (extra < 0)
+        return 0xFFFD;
+    uint32_t code = lead & (0x3F >> extra);
+    for (int i = 0; i < extra; ++i)
+    {
+        if (text == end || (static_cast<unsigned char>(*text) & 0xC0) != 0x80)
+            return 0xFFFD;
+        code = (code << 6) | (static_cast<unsigned char>(*text++) & 0x3F);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    return code;
+}
 
-    // destroy FreeType once finished
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
+bool RasterizeGlyph(FT_Face face, unsigned long code, GlyphBitmap &glyph)
+{
+    glyph = GlyphBitmap();
+    if (FT_Load_Char(face, code, FT_LOAD_DEFAULT))
+        return false;
+    glyph.Advance = face->glyph->advance.x;
+    // blank glyphs such as the space only carry an advance
+    if (face->glyph->format == FT_GLYPH_FORMAT_OUTLINE && face->glyph->outline.n_points == 0)
+        return true;
+
+#ifdef HAVE_FT_SDF
+    if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF))
+        return false;
+    FT_Bitmap &bitmap = face->glyph->bitmap;
+    glyph.Size = glm::ivec2(bitmap.width, bitmap.rows);
+    glyph.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+    for (unsigned int row = 0; row < bitmap.rows; ++row)
+        glyph.Pixels.insert(glyph.Pixels.end(), bitmap.buffer + row * bitmap.pitch, 
+                            bitmap.buffer + row * bitmap.pitch + bitmap.width);
+#else
+    // older FreeType has no SDF renderer, derive the field from the coverage bitmap instead
+    if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL))
+        return false;
+    FT_Bitmap &bitmap = face->glyph->bitmap;
+    int pad = SDF_SPREAD;
+    int width = bitmap.width, rows = bitmap.rows;
+    auto inside = [&](int x, int y) {
+        return x >= 0 && y >= 0 && x < width && y < rows && bitmap.buffer[y * bitmap.pitch + x] >= 128;
+    };
+    glyph.Size = glm::ivec2(width + 2 * pad, rows + 2 * pad);
+    glyph.Bearing = glm::ivec2(face->glyph->bitmap_left - pad, face->glyph->bitmap_top + pad);
+    glyph.Pixels.resize(glyph.Size.x * glyph.Size.y);
+    for (int y = 0; y < glyph.Size.y; ++y)
+    {
+        for (int x = 0; x < glyph.Size.x; ++x)
+        {
+            // nearest pixel of the opposite state within the spread
+            bool in = inside(x - pad, y - pad);
+            float nearest = static_cast<float>(pad);
+            for (int dy = -pad; dy <= pad; ++dy)
+                for (int dx = -pad; dx <= pad; ++dx)
+                    if (inside(x - pad + dx, y - pad + dy) != in)
+                        nearest = std::min(nearest, std::sqrt(static_cast<float>(dx * dx + dy * dy)) - 0.5f);
+            float distance = in ? nearest : -nearest;
+            float value = 128.0f + distance / SDF_SPREAD * 128.0f;
+            glyph.Pixels[y * glyph.Size.x + x] = static_cast<unsigned char>(std::max(0.0f, std::min(255.0f, value)));
+        }
+    }
+#endif
+    return true;
 }
 
 void TextRenderer::RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
 {
+    unsigned int glyphs = this->acquireString(text.data(), text.size());
+    this->vertexData.resize(glyphs * GLYPH_FLOATS);
+    this->layoutString(text.data(), text.size(), x, y, scale, color, this->vertexData.data());
+    // the staging buffer now belongs to this string, queued ones have to be rebuilt
+    this->built = false;
+
     // activate corresponding render state	
     this->TextShader.Use();
-    this->TextShader.SetVector3f("textColor", color);
     glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(this->VAO);
+    this->Atlas.Bind();
+    this->drawGlyphs(0, glyphs);
+}
 
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+void TextRenderer::beginQueue(RenderQueue &queue)
+{
+    // strings from frames that were already executed are no longer referenced
+    if (this->queuedFrame != queue.Frame)
     {
-        Character ch = Characters[*c];
+        this->queued.clear();
+        this->textArena.clear();
+        this->queuedFrame = queue.Frame;
+        this->queuedGlyphs = 0;
+        // glyphs touched from here on are referenced by this frame and can't be evicted
+        this->frameTick = this->useTick;
+    }
+    this->built = false;
+    RenderCommand &command = queue.Submit(LAYER_HUD, BLEND_ALPHA, this->TextShader.ID, this->Atlas.ID, 
+                                            &TextRenderer::execute, this);
+    command.Payload = this->queued.size();
+}
+
+void TextRenderer::SubmitText(RenderQueue &queue, const char *text, float x, float y, float scale, glm::vec3 color)
+{
+    this->beginQueue(queue);
+    unsigned int length = std::strlen(text);
+    unsigned int glyphs = this->acquireString(text, length);
+    this->queued.push_back({ nullptr, static_cast<unsigned int>(this->textArena.size()), length, glyphs, 
+                                x, y, scale, color, this->queuedGlyphs });
+    this->textArena.insert(this->textArena.end(), text, text + length);
+    this->queuedGlyphs += glyphs;
+}
+
+void TextRenderer::SubmitText(RenderQueue &queue, const std::string &text, float x, float y, float scale, 
+                                glm::vec3 color)
+{
+    this->SubmitText(queue, text.c_str(), x, y, scale, color);
+}
+
+void TextRenderer::SubmitLabel(RenderQueue &queue, TextLabel &label, float x, float y, float scale, glm::vec3 color)
+{
+    this->beginQueue(queue);
+    // touching the glyphs keeps them resident for this frame even when the run is reused
+    unsigned int glyphs = this->acquireString(label.Text(), label.Length());
+    if (label.runScale != scale || label.runColor != color || label.runGeneration != this->generation)
+    {
+        label.runScale = scale;
+        label.runColor = color;
+        label.dirty = true;
+    }
+    this->queued.push_back({ &label, 0, label.Length(), glyphs, x, y, scale, color, this->queuedGlyphs });
+    this->queuedGlyphs += glyphs;
+}
+
+void TextRenderer::BuildVertices(WorkerPool *pool)
+{
+    this->vertexData.resize(this->queuedGlyphs * GLYPH_FLOATS);
+
+    // every string owns the region starting at its FirstGlyph, so workers never overlap
+    auto build = [this](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i)
+        {
+            const QueuedText &text = this->queued[i];
+            float *out = &this->vertexData[text.FirstGlyph * GLYPH_FLOATS];
+            if (!text.Label)
+            {
+                this->layoutString(&this->textArena[text.TextOffset], text.Length, text.X, text.Y, 
+                                    text.Scale, text.Color, out);
+                continue;
+            }
+
+            // labels keep their run at the origin and are only translated into place
+            TextLabel &label = *text.Label;
+            if (label.dirty)
+            {
+                label.run.resize(text.Glyphs * GLYPH_FLOATS);
+                this->layoutString(label.Text(), label.Length(), 0.0f, 0.0f, text.Scale, text.Color, 
+                                    label.run.data());
+                label.runGeneration = this->generation;
+                label.dirty = false;
+            }
+            for (unsigned int v = 0; v < text.Glyphs * 6; ++v)
+            {
+                const float *vertex = &label.run[v * 7];
+                out[v * 7 + 0] = vertex[0] + text.X;
+                out[v * 7 + 1] = vertex[1] + text.Y;
+                std::copy(vertex + 2, vertex + 7, out + v * 7 + 2);
+            }
+        }
+    };
+    if (pool)
+        pool->ParallelFor(this->queued.size(), 8, build);
+    else
+        build(0, this->queued.size());
+    this->built = true;
+}
+
+void TextRenderer::execute(void *owner, const RenderCommand *commands, unsigned int count)
+{
+    TextRenderer *renderer = static_cast<TextRenderer*>(owner);
+    if (!renderer->built)
+        renderer->BuildVertices(nullptr);
+    // a batch holds strings in submission order, so their quads form one contiguous range
+    const QueuedText &first = renderer->queued[commands[0].Payload];
+    const QueuedText &last = renderer->queued[commands[count - 1].Payload];
+    renderer->drawGlyphs(first.FirstGlyph, last.FirstGlyph + last.Glyphs - first.FirstGlyph);
+}
+
+const Character &TextRenderer::glyph(uint32_t code) const
+{
+    // glyphs that could not be made resident are drawn as nothing
+    static const Character missing = Character();
+    int slot = this->findSlot(code);
+    return slot >= 0 ? this->slots[slot].Glyph : missing;
+}
+
+void TextRenderer::layoutString(const char *text, unsigned int length, float x, float y, float scale, 
+                                    glm::vec3 color, float *vertices) const
+{
+    // metrics are stored at SDF_GLYPH_SIZE
+    scale *= this->glyphScale;
+    for (const char *p = text, *end = text + length; p < end; )
+    {
+        const Character &ch = this->glyph(NextCodePoint(p, end));
 
         float xpos = x + ch.Bearing.x * scale;
-        float ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+        float ypos = y + (this->capHeight - ch.Bearing.y) * scale;
 
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
 
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 0.0f },
+        float u0 = ch.UVMin.x, v0 = ch.UVMin.y, u1 = ch.UVMax.x, v1 = ch.UVMax.y;
+        float quad[6][7] = {
+            { xpos,     ypos + h,   u0, v1, color.x, color.y, color.z },
+            { xpos + w, ypos,       u1, v0, color.x, color.y, color.z },
+            { xpos,     ypos,       u0, v0, color.x, color.y, color.z },
 
-            { xpos,     ypos + h,   0.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 0.0f }
+            { xpos,     ypos + h,   u0, v1, color.x, color.y, color.z },
+            { xpos + w, ypos + h,   u1, v1, color.x, color.y, color.z },
+            { xpos + w, ypos,       u1, v0, color.x, color.y, color.z }
         };
-
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        std::copy(&quad[0][0], &quad[0][0] + GLYPH_FLOATS, vertices);
+        vertices += GLYPH_FLOATS;
 
         // advance cursors for next glyph
         x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void TextRenderer::drawGlyphs(unsigned int first, unsigned int count)
+{
+    if (count == 0)
+        return;
+    unsigned int offset = this->stream->Upload(&this->vertexData[first * GLYPH_FLOATS], 
+                                                sizeof(float) * GLYPH_FLOATS * count);
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->stream->ID);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(uintptr_t)offset);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*)(uintptr_t)(offset + 4 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArrays(GL_TRIANGLES, 0, count * 6);
+    glBindVertexArray(0);
+}
@@ -1,42 +1,277 @@
 #ifndef TEXT_RENDERER_H
 #define TEXT_RENDERER_H
 
-#include <map>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
 
 #include "texture.h"
 #include "shader.h"
+#include "render_queue.h"
+#include "worker_pool.h"
+#include "stream_buffer.h"
 
 
-// state information relevant to a character as loaded using FreeType
+// state information relevant to a character as loaded using FreeType, in SDF_GLYPH_SIZE pixels
 struct Character {
-    unsigned int TextureID; 
     glm::ivec2 Size;      
     glm::ivec2 Bearing;     // offset from baseline to left/top of glyph
     long Advance;   // horizontal offset to advance to next glyph
+    glm::vec2 UVMin, UVMax; // glyph rectangle inside the atlas
+};
+
+// glyphs are rasterized once as signed distance fields at this pixel size and scaled to any size
+const unsigned int SDF_GLYPH_SIZE = 32;
+// distance in pixels, to either side of the outline, covered by the 0..255 range
+const int SDF_SPREAD = 6;
+
+// glyphs are rasterized on first use into one fixed page of square slots
+const unsigned int GLYPH_PAGE_SIZE = 1024;
+const unsigned int GLYPH_SLOT_SIZE = 64;
+const unsigned int GLYPH_SLOTS = (GLYPH_PAGE_SIZE / GLYPH_SLOT_SIZE) * (GLYPH_PAGE_SIZE / GLYPH_SLOT_SIZE);
+
+// floats per glyph: 6 vertices of <vec2 pos, vec2 tex, vec3 color>
+const unsigned int GLYPH_FLOATS = 6 * 7;
+
+// Text (UTF-8) built from literals and numbers in a fixed buffer with std::to_chars. Its glyph 
+// run is laid out once relative to the origin and reused until the formatted text changes.
+// Text past CAPACITY is cut off at the last argument that fit, debug builds assert instead.
+class TextLabel
+{
+public:
+    // the longest debug overlay line is about 95 characters with large counts
+    static const unsigned int CAPACITY = 128;
+
+    TextLabel() : length(0), dirty(true), runScale(0.0f), runColor(0.0f), runGeneration(0) { }
+
+    // rewrites the label, e.g. Format("X:", x, ", Y:", y); the run is only flagged for
+    // layout again if the resulting text differs from the current one
+    template<typename... Args>
+    void Format(const Args&... args)
+    {
+        char buffer[CAPACITY];
+        char *end = buffer;
+        bool fits = (append(end, buffer + CAPACITY, args) && ...);
+        assert(fits && "TextLabel::Format: text exceeds CAPACITY");
+        (void)fits;
+        unsigned int newLength = end - buffer;
+        if (newLength != this->length || std::memcmp(buffer, this->text, newLength) != 0)
+        {
+            std::memcpy(this->text, buffer, newLength);
+            this->length = newLength;
+            this->dirty = true;
+        }
+    }
+
+    const char *Text() const { return this->text; }
+    unsigned int Length() const { return this->length; }
+
+private:
+    friend class TextRenderer;
+
+    char text[CAPACITY];
+    unsigned int length;
+    // glyph quads laid out at the origin with the scale, color and atlas generation they were built for
+    bool dirty;
+    float runScale;
+    glm::vec3 runColor;
+    unsigned int runGeneration;
+    std::vector<float> run;
+
+    // each appends a whole value or, when it doesn't fit, nothing and returns false
+    static bool append(char *&pos, char *end, const char *value)
+    {
+        size_t length = std::strlen(value);
+        if (length > static_cast<size_t>(end - pos))
+            return false;
+        pos = std::copy(value, value + length, pos);
+        return true;
+    }
+    // on failure to_chars leaves the bytes it was given unspecified, they are not kept
+    static bool appended(char *&pos, std::to_chars_result result)
+    {
+        if (result.ec != std::errc())
+            return false;
+        pos = result.ptr;
+        return true;
+    }
+    static bool append(char *&pos, char *end, int value) { return appended(pos, std::to_chars(pos, end, value)); }
+    static bool append(char *&pos, char *end, unsigned int value) { return appended(pos, std::to_chars(pos, end, value)); }
+    // same 6 significant digits a default std::stringstream prints
+    static bool append(char *&pos, char *end, float value) 
+    { 
+        return appended(pos, std::to_chars(pos, end, value, std::chars_format::general, 6)); 
+    }
+};
+
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+#define HAVE_FT_SDF 1
+#endif
+
+// a glyph rasterized as a distance field, before it is placed into an atlas
+struct GlyphBitmap {
+    glm::ivec2 Size;
+    glm::ivec2 Bearing;
+    long Advance;
+    std::vector<unsigned char> Pixels;
+};
+
+// renders a glyph of the face, set to SDF_GLYPH_SIZE, as a distance field with SDF_SPREAD pixels of 
+// range; blank glyphs come back with only their advance
+bool RasterizeGlyph(FT_Face face, unsigned long code, GlyphBitmap &glyph);
+// top of the capitals above the baseline in distance field pixels, for a face set to SDF_GLYPH_SIZE
+int GlyphCapHeight(FT_Face face);
+
+// serialized glyph shared by the on-disk glyph cache and asset packs
+void WriteGlyphRecord(std::vector<char> &out, uint32_t code, const GlyphBitmap &glyph);
+// reads the glyph at data, returns the bytes it took or 0 if the record is cut off
+size_t ReadGlyphRecord(const char *data, size_t size, uint32_t &code, GlyphBitmap &glyph);
+
+// decodes the UTF-8 sequence at text and advances past it, malformed input yields U+FFFD
+uint32_t NextCodePoint(const char *&text, const char *end);
+
+// glyph lookups since the font was loaded; a miss rasterizes (or reads from disk) and uploads a glyph
+struct GlyphCacheStats {
+    unsigned int Hits, Misses, Evictions, Resident;
+};
+
+// a string or label waiting in the render queue
+struct QueuedText {
+    TextLabel *Label;           // set for labels, otherwise the text lives in the frame's text arena
+    unsigned int TextOffset, Length;    // bytes of UTF-8
+    unsigned int Glyphs;                // code points, one quad each
+    float X, Y, Scale;
+    glm::vec3 Color;
+    unsigned int FirstGlyph;    // where its quads start in the frame's vertex staging buffer
 };
 
 
 class TextRenderer
 {
 public:
-    // pre-compiled Characters
-    std::map<char, Character> Characters; 
+    // resident glyphs as single channel distance fields, GLYPH_SLOTS of them at most
+    Texture2D Atlas;
+    GlyphCacheStats GlyphStats;
 
     Shader TextShader;
 
-    TextRenderer(unsigned int width, unsigned int height);
+    TextRenderer(unsigned int width, unsigned int height, StreamBuffer &stream);
+    ~TextRenderer();
 
-    // pre-compiles characters from the given font
+    // opens the given font, glyphs are only rasterized (or read from the on-disk cache) once a 
+    // string using them is drawn; fontSize is the pixel size drawn at scale 1.0
     void Load(std::string font, unsigned int fontSize);
 
     void RenderText(std::string text, float x, float y, float scale, 
                         glm::vec3 color = glm::vec3(1.0f));
+
+    // text is UTF-8; queues a string on the HUD layer, all queued strings are drawn as a single batch; the 
+    // characters are copied into a per-frame arena that keeps its capacity between frames
+    void SubmitText(RenderQueue &queue, const char *text, float x, float y, float scale, 
+                        glm::vec3 color = glm::vec3(1.0f));
+    void SubmitText(RenderQueue &queue, const std::string &text, float x, float y, float scale, 
+                        glm::vec3 color = glm::vec3(1.0f));
+
+    // queues a label, its cached glyph run is only laid out again when its text, scale or color 
+    // changed; the label has to stay alive until the queue is executed and be queued once per frame
+    void SubmitLabel(RenderQueue &queue, TextLabel &label, float x, float y, float scale, 
+                        glm::vec3 color = glm::vec3(1.0f));
+
+    // lays out the quads of every queued string, split across the pool's workers when one is given
+    void BuildVertices(WorkerPool *pool);
 private:
-    unsigned int VAO, VBO;
+    unsigned int VAO;
+    StreamBuffer *stream;
+    std::vector<QueuedText> queued;
+    std::vector<char> textArena;
+    unsigned int queuedFrame, queuedGlyphs;
+    bool built;
+    // bearing of 'H', aligns every string to the top of its capitals
+    float capHeight;
+    // converts SDF_GLYPH_SIZE pixels into pixels at scale 1.0
+    float glyphScale;
+
+    // GLYPH_FLOATS for every queued character
+    std::vector<float> vertexData;
+
+    // the font stays open to rasterize glyphs on demand
+    FT_Library ft;
+    FT_Face face;
+    std::vector<unsigned char> fontData;
+    // set while the glyphs came from the asset pack and the font was not opened yet
+    std::string fontPath;
+
+    struct GlyphSlot {
+        uint32_t Code = 0;
+        bool Occupied = false;
+        uint64_t LastUse = 0;
+        Character Glyph = Character();
+    };
+    std::vector<GlyphSlot> slots;
+    // slot of a code point, a flat table for ASCII and a map for everything else
+    std::array<int, 128> asciiSlots;
+    std::unordered_map<uint32_t, int> slotOfCode;
+    // slots used after frameTick are referenced by queued text
+    uint64_t useTick, frameTick;
+    // bumped whenever a slot changes, invalidates the glyph runs of labels
+    unsigned int generation;
+    std::vector<unsigned char> slotPixels;
+
+    // where every distance field generated for this font so far can be read back; only resident 
+    // glyphs are held in memory, a miss reads the record from the pack mapping or the disk cache
+    std::string cachePath;
+    std::unordered_map<uint32_t, const char*> packedGlyphs;
+    const char *packedEnd;
+    std::unordered_map<uint32_t, uint64_t> cachedGlyphs;
+    // open for reading records back, appends go through their own stream; cacheEnd is where the 
+    // next record lands
+    std::ifstream cacheFile;
+    uint64_t cacheEnd;
+
+    // makes a glyph resident and marks it used, returns its slot or -1 when every slot is taken 
+    // by this frame's text; only called from the main thread, layout just reads the slots
+    int acquire(uint32_t code);
+    // acquires every code point of a string and returns how many there are
+    unsigned int acquireString(const char *text, unsigned int length);
+    int findSlot(uint32_t code) const;
+    const Character &glyph(uint32_t code) const;
+    bool fetchGlyph(uint32_t code, GlyphBitmap &bitmap);
+    // opens the face and the on-disk glyph cache
+    void openFont(std::string font);
+    // indexes the records of a PACK_GLYPHS blob in place, false if it was built for other SDF settings
+    bool readPackedGlyphs(const unsigned char *data, size_t size);
+
+    // cache file layout: header, then a record and the pixels of every glyph in rasterization order; 
+    // opening only indexes the records, their pixels stay on disk
+    void openCache(uint64_t fontHash);
+    bool readCachedGlyph(uint64_t offset, GlyphBitmap &bitmap);
+    void appendCache(uint32_t code, const GlyphBitmap &bitmap);
+
+    // resets the per-frame storage once the queue moved on to a new frame
+    void beginQueue(RenderQueue &queue);
+
+    // writes the quads of a string into the given region
+    void layoutString(const char *text, unsigned int length, float x, float y, float scale, glm::vec3 color, 
+                        float *vertices) const;
+
+    // streams the staged quads of glyphs [first, first + count) and draws them with one call,
+    // the text shader and atlas must already be bound
+    void drawGlyphs(unsigned int first, unsigned int count);
+
+    static void execute(void *owner, const RenderCommand *commands, unsigned int count);
 };
 
 #endif 
-
@@ -1,37 +1,144 @@
 #include <iostream>
+#include <vector>
 
 #include "texture.h"
+#include "gl_extensions.h"
 
+std::unordered_map<unsigned int, TextureRegistry::Record> TextureRegistry::records;
 
-Texture2D::Texture2D()
-    : Width(0), Height(0), Internal_Format(GL_RGB), Image_Format(GL_RGB), Wrap_S(GL_REPEAT), 
-        Wrap_T(GL_REPEAT), Filter_Min(GL_LINEAR), Filter_Max(GL_LINEAR)
+
+void Texture2D::Bind() const
+{
+    glBindTexture(GL_TEXTURE_2D, this->ID);
+}
+
+Texture2D TextureRegistry::Create(unsigned int width, unsigned int height, const unsigned char *data, 
+                                    const TextureParams &params)
 {
-    glGenTextures(1, &this->ID);
+    Texture2D texture;
+    glGenTextures(1, &texture.ID);
+    records[texture.ID] = { 0, 0 };
+    Update(texture, width, height, data, params);
+    return texture;
 }
 
-void Texture2D::Generate(unsigned int width, unsigned int height, unsigned char* data)
+void TextureRegistry::Update(Texture2D &texture, unsigned int width, unsigned int height, const unsigned char *data, 
+                                const TextureParams &params)
 {
-    this->Width = width;
-    this->Height = height;
+    texture.Width = width;
+    texture.Height = height;
 
-    // create Texture
-    glBindTexture(GL_TEXTURE_2D, this->ID);
-    glTexImage2D(GL_TEXTURE_2D, 0, this->Internal_Format, width, height, 0, this->Image_Format, 
+    // (re)specify Texture
+    glBindTexture(GL_TEXTURE_2D, texture.ID);
+    glTexImage2D(GL_TEXTURE_2D, 0, params.Internal_Format, width, height, 0, params.Image_Format, 
                     GL_UNSIGNED_BYTE, data);
 
-    // set Texture wrap and filter modes
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->Wrap_S);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->Wrap_T);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->Filter_Min);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->Filter_Max);
+    unsigned int levels = 1;
+    if (params.Mipmaps)
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        levels = MipLevels(width, height);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    setParameters(params);
 
     // unbind
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    unsigned int channels = params.Internal_Format == GL_RED ? 1 : params.Internal_Format == GL_RGB ? 3 : 4;
+    size_t bytes = static_cast<size_t>(width) * height * channels;
+    // a full chain adds a third on top of level 0
+    records[texture.ID] = { levels > 1 ? bytes + bytes / 3 : bytes, levels };
 }
 
-void Texture2D::Bind() const
+Texture2D TextureRegistry::CreateCompressed(unsigned int width, unsigned int height, BlockFormat format, 
+                                            unsigned int levels, const unsigned char *data, const TextureParams &params)
 {
-    glBindTexture(GL_TEXTURE_2D, this->ID);
+    Texture2D texture;
+    glGenTextures(1, &texture.ID);
+    records[texture.ID] = { 0, 0 };
+    UpdateCompressed(texture, width, height, format, levels, data, params);
+    return texture;
+}
+
+void TextureRegistry::UpdateCompressed(Texture2D &texture, unsigned int width, unsigned int height, BlockFormat format, 
+                                        unsigned int levels, const unsigned char *data, const TextureParams &params)
+{
+    texture.Width = width;
+    texture.Height = height;
+
+    glBindTexture(GL_TEXTURE_2D, texture.ID);
+    GLenum internalFormat = format == BLOCK_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    std::vector<unsigned char> decoded;
+    size_t bytes = 0;
+    for (unsigned int level = 0; level < levels; ++level)
+    {
+        size_t size = BlockImageSize(format, width, height);
+        if (GLExtensions::TextureCompressionS3TC)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, size, data);
+            bytes += size;
+        }
+        else
+        {
+            decoded.resize(static_cast<size_t>(width) * height * 4);
+            DecompressImage(format, data, width, height, decoded.data());
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
+            bytes += decoded.size();
+        }
+        data += size;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    setParameters(params);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    records[texture.ID] = { bytes, levels };
 }
 
+void TextureRegistry::setParameters(const TextureParams &params)
+{
+    // set Texture wrap and filter modes
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.Wrap_S);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.Wrap_T);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.Filter_Min);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.Filter_Max);
+}
+
+size_t TextureRegistry::Bytes(const Texture2D &texture)
+{
+    auto iter = records.find(texture.ID);
+    return iter != records.end() ? iter->second.Bytes : 0;
+}
+
+void TextureRegistry::Evict(Texture2D &texture)
+{
+    auto iter = records.find(texture.ID);
+    if (iter == records.end())
+        return;
+    // zero sized levels release the driver's storage, the name stays bound wherever it is used
+    glBindTexture(GL_TEXTURE_2D, texture.ID);
+    for (unsigned int level = 0; level < iter->second.Levels; ++level)
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    iter->second = { 0, 0 };
+}
+
+void TextureRegistry::Destroy(Texture2D &texture)
+{
+    if (records.erase(texture.ID) == 0)
+    {
+        if (texture.ID != 0)
+            std::cout << "ERROR::TEXTURE: Destroying unknown texture " << texture.ID << std::endl;
+        return;
+    }
+    glDeleteTextures(1, &texture.ID);
+    texture = Texture2D();
+}
+
+void TextureRegistry::Clear()
+{
+    for (auto &iter : records)
+        glDeleteTextures(1, &iter.first);
+    records.clear();
+}
@@ -1,8 +1,31 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <cstddef>
+#include <type_traits>
+#include <unordered_map>
+
 #include <glad/glad.h>
 
+#include "texture_compression.h"
+
+// format and sampling of a texture, only needed while it is created
+struct TextureParams
+{
+    unsigned int Internal_Format = GL_RGB;
+    unsigned int Image_Format = GL_RGB;
+
+    // config
+    unsigned int Wrap_S = GL_REPEAT;
+    unsigned int Wrap_T = GL_REPEAT;
+    unsigned int Filter_Min = GL_LINEAR; // if texture pixels < screen pixels
+    unsigned int Filter_Max = GL_LINEAR; // if texture pixels > screen pixels
+    // builds the mip chain after uploading level 0, pair it with a mipmap Filter_Min
+    bool Mipmaps = false;
+};
+
+// Handle to a texture owned by the TextureRegistry. Constructing or copying one never 
+// touches GL; an ID of 0 is no texture.
 class Texture2D
 {
 public:
@@ -11,22 +34,59 @@ public:
     unsigned int Width;
     unsigned int Height;
 
-    unsigned int Internal_Format;
-    unsigned int Image_Format;
+    Texture2D() : ID(0), Width(0), Height(0) { }
 
-    // config
-    unsigned int Wrap_S;
-    unsigned int Wrap_T;
-    unsigned int Filter_Min; // if texture pixels < screen pixels
-    unsigned int Filter_Max; // if texture pixels > screen pixels
+    // binds texture as current active GL_TEXTURE_2D texture object
+    void Bind() const;
+};
+
+static_assert(std::is_trivially_copyable<Texture2D>::value, "Texture2D is passed around by value");
 
-    Texture2D();
+// Owns the GL name of every texture, handles stay valid until their texture is destroyed
+class TextureRegistry
+{
+public:
+    // generates a texture and fills it from data, which is an offset into the bound 
+    // GL_PIXEL_UNPACK_BUFFER if there is one and may be null to leave it uninitialized
+    static Texture2D Create(unsigned int width, unsigned int height, const unsigned char *data, 
+                            const TextureParams &params = TextureParams());
 
-    void Generate(unsigned int width, unsigned int height, unsigned char* data);
+    // respecifies an existing texture with new contents, its name and every copy of the handle stay valid
+    static void Update(Texture2D &texture, unsigned int width, unsigned int height, const unsigned char *data, 
+                        const TextureParams &params = TextureParams());
 
-    // binds texture as current active GL_TEXTURE_2D texture object
-    void Bind() const;
+    // uploads a block compressed mip chain (levels concatenated, largest first, down to 1x1 or as 
+    // many as given), decoding it to RGBA8 on the CPU when the driver lacks S3TC
+    static Texture2D CreateCompressed(unsigned int width, unsigned int height, BlockFormat format, unsigned int levels, 
+                                        const unsigned char *data, const TextureParams &params);
+    static void UpdateCompressed(Texture2D &texture, unsigned int width, unsigned int height, BlockFormat format, 
+                                    unsigned int levels, const unsigned char *data, const TextureParams &params);
+
+    // frees the storage of the texture but keeps its name, sampling it reads zeros until the next Update
+    static void Evict(Texture2D &texture);
+
+    // GPU memory of the texture as specified (RGB counted as 3 bytes, padding is up to the driver)
+    static size_t Bytes(const Texture2D &texture);
+
+    // deletes the texture and resets the handle, copies of it dangle afterwards
+    static void Destroy(Texture2D &texture);
+
+    // deletes every texture still alive
+    static void Clear();
+
+    static size_t Count() { return records.size(); }
+private:
+    TextureRegistry() { }
+
+    struct Record {
+        size_t Bytes;
+        unsigned int Levels;
+    };
+    // every live texture by name
+    static std::unordered_map<unsigned int, Record> records;
+
+    // wrap and filter modes of the bound texture
+    static void setParameters(const TextureParams &params);
 };
 
 #endif
-
@@ -0,0 +1,232 @@
+#include "texture_compression.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+
+unsigned int MipLevels(unsigned int width, unsigned int height)
+{
+    unsigned int levels = 1;
+    for (unsigned int size = std::max(width, height); size > 1; size /= 2)
+        ++levels;
+    return levels;
+}
+
+size_t BlockImageSize(BlockFormat format, unsigned int width, unsigned int height)
+{
+    size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * (format == BLOCK_BC3 ? 16 : 8);
+}
+
+std::vector<unsigned char> DownsampleRGBA(const unsigned char *rgba, unsigned int width, unsigned int height)
+{
+    unsigned int halfWidth = std::max(width / 2, 1u), halfHeight = std::max(height / 2, 1u);
+    std::vector<unsigned char> half(static_cast<size_t>(halfWidth) * halfHeight * 4);
+    for (unsigned int y = 0; y < halfHeight; ++y)
+        for (unsigned int x = 0; x < halfWidth; ++x)
+        {
+            unsigned int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            unsigned int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for (unsigned int c = 0; c < 4; ++c)
+            {
+                unsigned int sum = rgba[(y0 * width + x0) * 4 + c] + rgba[(y0 * width + x1) * 4 + c] +
+                                    rgba[(y1 * width + x0) * 4 + c] + rgba[(y1 * width + x1) * 4 + c];
+                half[(static_cast<size_t>(y) * halfWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    return half;
+}
+
+// 5:6:5 endpoint, and back to 8 bits per channel the way the hardware expands it
+static uint16_t packColor(const int color[3])
+{
+    int r = (color[0] * 31 + 127) / 255, g = (color[1] * 63 + 127) / 255, b = (color[2] * 31 + 127) / 255;
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackColor(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// the 4 (or 3 plus transparent black) colors a BC1 block interpolates between its endpoints
+static void colorPalette(uint16_t c0, uint16_t c1, bool fourColors, int palette[4][4])
+{
+    unpackColor(c0, palette[0]);
+    unpackColor(c1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (fourColors)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    if (!fourColors)
+        palette[3][3] = 0;
+}
+
+static void alphaPalette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+        for (int i = 1; i < 7; ++i)
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    else
+    {
+        for (int i = 1; i < 5; ++i)
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void encodeColorBlock(const unsigned char pixels[16][4], unsigned char *out)
+{
+    // endpoints from the bounding box of the block, inset a little to cut the error at the extremes
+    int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+        {
+            low[c] = std::min<int>(low[c], pixels[i][c]);
+            high[c] = std::max<int>(high[c], pixels[i][c]);
+        }
+    for (int c = 0; c < 3; ++c)
+    {
+        int inset = (high[c] - low[c]) / 16;
+        low[c] += inset;
+        high[c] -= inset;
+    }
+    uint16_t c0 = packColor(high), c1 = packColor(low);
+    // c0 > c1 selects the four color mode
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int palette[4][4];
+        colorPalette(c0, c1, true, palette);
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; ++p)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; ++c)
+                    error += (pixels[i][c] - palette[p][c]) * (pixels[i][c] - palette[p][c]);
+                if (error < bestError)
+                {
+                    best = p;
+                    bestError = error;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+    out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+static void encodeAlphaBlock(const unsigned char pixels[16][4], unsigned char *out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        a0 = std::max<int>(a0, pixels[i][3]);
+        a1 = std::min<int>(a1, pixels[i][3]);
+    }
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        // a0 > a1 selects the eight value mode
+        int palette[8];
+        alphaPalette(a0, a1, palette);
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0;
+            for (int p = 1; p < 8; ++p)
+                if (std::abs(pixels[i][3] - palette[p]) < std::abs(pixels[i][3] - palette[best]))
+                    best = p;
+            indices |= static_cast<uint64_t>(best) << (3 * i);
+        }
+    }
+    out[0] = static_cast<unsigned char>(a0);
+    out[1] = static_cast<unsigned char>(a1);
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+std::vector<unsigned char> CompressImage(BlockFormat format, const unsigned char *rgba, unsigned int width,
+                                            unsigned int height)
+{
+    std::vector<unsigned char> blocks(BlockImageSize(format, width, height));
+    unsigned char *out = blocks.data();
+    for (unsigned int by = 0; by < height; by += 4)
+        for (unsigned int bx = 0; bx < width; bx += 4)
+        {
+            // partial blocks at the edges repeat the last row/column
+            unsigned char pixels[16][4];
+            for (unsigned int i = 0; i < 16; ++i)
+            {
+                unsigned int x = std::min(bx + i % 4, width - 1), y = std::min(by + i / 4, height - 1);
+                std::copy_n(rgba + (static_cast<size_t>(y) * width + x) * 4, 4, pixels[i]);
+            }
+            if (format == BLOCK_BC3)
+            {
+                encodeAlphaBlock(pixels, out);
+                out += 8;
+            }
+            encodeColorBlock(pixels, out);
+            out += 8;
+        }
+    return blocks;
+}
+
+void DecompressImage(BlockFormat format, const unsigned char *blocks, unsigned int width, unsigned int height,
+                        unsigned char *rgba)
+{
+    for (unsigned int by = 0; by < height; by += 4)
+        for (unsigned int bx = 0; bx < width; bx += 4)
+        {
+            int alphas[8];
+            uint64_t alphaIndices = 0;
+            if (format == BLOCK_BC3)
+            {
+                alphaPalette(blocks[0], blocks[1], alphas);
+                for (int i = 0; i < 6; ++i)
+                    alphaIndices |= static_cast<uint64_t>(blocks[2 + i]) << (8 * i);
+                blocks += 8;
+            }
+            uint16_t c0 = blocks[0] | (blocks[1] << 8), c1 = blocks[2] | (blocks[3] << 8);
+            uint32_t indices = blocks[4] | (blocks[5] << 8) | (blocks[6] << 16) | (static_cast<uint32_t>(blocks[7]) << 24);
+            blocks += 8;
+            // the color part of BC3 is always decoded with four colors
+            int palette[4][4];
+            colorPalette(c0, c1, format == BLOCK_BC3 || c0 > c1, palette);
+
+            for (unsigned int i = 0; i < 16; ++i)
+            {
+                unsigned int x = bx + i % 4, y = by + i / 4;
+                if (x >= width || y >= height)
+                    continue;
+                const int *color = palette[(indices >> (2 * i)) & 3];
+                unsigned char *pixel = rgba + (static_cast<size_t>(y) * width + x) * 4;
+                for (int c = 0; c < 3; ++c)
+                    pixel[c] = static_cast<unsigned char>(color[c]);
+                pixel[3] = static_cast<unsigned char>(format == BLOCK_BC3 ? alphas[(alphaIndices >> (3 * i)) & 7] : color[3]);
+            }
+        }
+}
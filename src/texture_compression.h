@@ -0,0 +1,31 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// S3TC block formats, 4x4 pixel blocks. BC1 (DXT1) stores opaque RGB in 8 bytes per block,
+// BC3 (DXT5) adds an interpolated alpha block in front for 16 bytes.
+enum BlockFormat : uint32_t {
+    BLOCK_BC1 = 1,
+    BLOCK_BC3 = 3
+};
+
+// mip levels of a full chain down to 1x1
+unsigned int MipLevels(unsigned int width, unsigned int height);
+
+// bytes of one level in the block format, partial blocks at the edges are padded
+size_t BlockImageSize(BlockFormat format, unsigned int width, unsigned int height);
+
+// half-size RGBA8 image with a 2x2 box filter, odd edges repeat their last pixel
+std::vector<unsigned char> DownsampleRGBA(const unsigned char *rgba, unsigned int width, unsigned int height);
+
+// encodes an RGBA8 image, range fit per block; fast and good enough for sprites and backgrounds
+std::vector<unsigned char> CompressImage(BlockFormat format, const unsigned char *rgba, unsigned int width,
+                                            unsigned int height);
+
+// decodes one level back to RGBA8 (width * height * 4 bytes), the fallback without S3TC support
+void DecompressImage(BlockFormat format, const unsigned char *blocks, unsigned int width, unsigned int height,
+                        unsigned char *rgba);
+
+#endif
@@ -0,0 +1,133 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+
+WorkerPool::WorkerPool(unsigned int threads)
+    : job(nullptr), count(0), grain(1), next(0), active(0), generation(0), stopping(false)
+{
+    for (unsigned int i = 0; i < threads; ++i)
+        this->workers.push_back(std::thread(&WorkerPool::workerLoop, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (std::thread &worker : this->workers)
+        worker.join();
+}
+
+unsigned int WorkerPool::Threads() const
+{
+    return this->workers.size();
+}
+
+void WorkerPool::ParallelFor(unsigned int count, unsigned int grain, 
+                                const std::function<void(unsigned int, unsigned int)> &job)
+{
+    grain = std::max(grain, 1u);
+    // not worth waking anyone up
+    if (this->workers.empty() || count <= grain)
+    {
+        if (count > 0)
+            job(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->job = &job;
+        this->count = count;
+        this->grain = grain;
+        this->next = 0;
+        this->active = this->workers.size();
+        ++this->generation;
+    }
+    this->wake.notify_all();
+
+    // the calling thread helps instead of idling
+    this->runChunks();
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->done.wait(lock, [this]() { return this->active == 0; });
+    this->job = nullptr;
+}
+
+void WorkerPool::Async(std::function<void()> task)
+{
+    if (this->workers.empty())
+    {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->tasks.push_back(std::move(task));
+    }
+    this->wake.notify_one();
+}
+
+bool WorkerPool::RunTask()
+{
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->tasks.empty())
+            return false;
+        task = std::move(this->tasks.front());
+        this->tasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+void WorkerPool::runChunks()
+{
+    while (true)
+    {
+        unsigned int begin = this->next.fetch_add(this->grain);
+        if (begin >= this->count)
+            break;
+        (*this->job)(begin, std::min(begin + this->grain, this->count));
+    }
+}
+
+void WorkerPool::workerLoop()
+{
+    unsigned int seen = 0;
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [this, seen]() { 
+                return this->stopping || this->generation != seen || !this->tasks.empty(); 
+            });
+            if (this->stopping)
+                return;
+            // a ParallelFor waits on every worker, so it goes before queued tasks
+            if (this->generation == seen)
+            {
+                task = std::move(this->tasks.front());
+                this->tasks.pop_front();
+            }
+            else
+                seen = this->generation;
+        }
+        if (task)
+        {
+            task();
+            continue;
+        }
+
+        this->runChunks();
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (--this->active == 0)
+            this->done.notify_one();
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads used to split per-frame CPU work into disjoint ranges, or to 
+// run independent tasks in the background. With zero threads every job simply runs on the 
+// calling thread.
+class WorkerPool
+{
+public:
+    WorkerPool(unsigned int threads);
+    ~WorkerPool();
+
+    unsigned int Threads() const;
+
+    // runs job(begin, end) over [0, count) in chunks of grain items on the workers and the 
+    // calling thread, returns once every chunk is done
+    void ParallelFor(unsigned int count, unsigned int grain, 
+                        const std::function<void(unsigned int, unsigned int)> &job);
+
+    // queues a task for the next idle worker, without workers it runs right away; the task has 
+    // to signal its own completion. A ParallelFor issued meanwhile waits for running tasks.
+    void Async(std::function<void()> task);
+    // runs one queued task on the calling thread, false if none was left
+    bool RunTask();
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+
+    // current job, published under the mutex
+    const std::function<void(unsigned int, unsigned int)> *job;
+    unsigned int count, grain;
+    std::atomic<unsigned int> next;
+    unsigned int active;
+    unsigned int generation;
+    bool stopping;
+    std::deque<std::function<void()>> tasks;
+
+    void workerLoop();
+    void runChunks();
+};
+
+#endif
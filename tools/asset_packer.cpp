@@ -0,0 +1,177 @@
+// Bakes the game's assets into one memory-mappable pack, see src/asset_pack.h: textures 
+// block compressed with full mip chains (or decoded to RGBA with --uncompressed), shader 
+// sources, levels compiled to tile grids and the printable ASCII glyphs of every font 
+// rasterized as distance fields.
+//
+// usage, from the repository root: asset_packer [--uncompressed] [output, default assets.pack]
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "game_level.h"
+#include "text_renderer.h"
+#include "texture_compression.h"
+#include "stb_image.h"
+
+// files of a directory with one of the extensions, as "dir/name" in a stable order
+static std::vector<std::string> listFiles(const std::string &directory, const std::vector<std::string> &extensions)
+{
+    std::vector<std::string> files;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (entry.is_regular_file() && std::find(extensions.begin(), extensions.end(), extension) != extensions.end())
+            files.push_back(directory + "/" + entry.path().filename().string());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+static bool packTexture(AssetPackWriter &pack, const std::string &file, bool compress)
+{
+    int width, height, nrChannels;
+    unsigned char *data = stbi_load(file.c_str(), &width, &height, &nrChannels, 4);
+    if (!data)
+        return false;
+    size_t pixels = static_cast<size_t>(width) * height;
+    if (!compress)
+    {
+        pack.Add(file, PACK_TEXTURE, width, height, data, pixels * 4);
+        stbi_image_free(data);
+        return true;
+    }
+
+    // BC1 unless some pixel isn't opaque
+    BlockFormat format = BLOCK_BC1;
+    for (size_t i = 0; i < pixels; ++i)
+        if (data[i * 4 + 3] != 255)
+        {
+            format = BLOCK_BC3;
+            break;
+        }
+    std::vector<unsigned char> level(data, data + pixels * 4), blocks;
+    stbi_image_free(data);
+    unsigned int levelWidth = width, levelHeight = height, levels = MipLevels(width, height);
+    for (unsigned int i = 0; i < levels; ++i)
+    {
+        std::vector<unsigned char> compressed = CompressImage(format, level.data(), levelWidth, levelHeight);
+        blocks.insert(blocks.end(), compressed.begin(), compressed.end());
+        if (i + 1 < levels)
+        {
+            level = DownsampleRGBA(level.data(), levelWidth, levelHeight);
+            levelWidth = std::max(levelWidth / 2, 1u);
+            levelHeight = std::max(levelHeight / 2, 1u);
+        }
+    }
+    pack.Add(file, PACK_TEXTURE_BC, width, height, blocks.data(), blocks.size(), format, levels);
+    std::cout << file << ": " << (format == BLOCK_BC3 ? "BC3" : "BC1") << ", " << levels << " levels, " 
+                << blocks.size() / 1024 << " KB (RGBA " << pixels * 4 / 1024 << " KB)" << std::endl;
+    return true;
+}
+
+static bool packShader(AssetPackWriter &pack, const std::string &file)
+{
+    std::ifstream stream(file, std::ios::binary);
+    std::string source((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (!stream)
+        return false;
+    pack.Add(file, PACK_SHADER, 0, 0, source.data(), source.size());
+    return true;
+}
+
+static bool packLevel(AssetPackWriter &pack, const std::string &file)
+{
+    LevelTiles tiles = GameLevel::ReadTiles(file.c_str());
+    if (tiles.Height == 0)
+        return false;
+    pack.Add(file, PACK_LEVEL, tiles.Width, tiles.Height, tiles.Codes.data(), tiles.Codes.size() * sizeof(uint32_t));
+    return true;
+}
+
+static bool packGlyphs(AssetPackWriter &pack, FT_Library ft, const std::string &file)
+{
+    FT_Face face;
+    if (FT_New_Face(ft, file.c_str(), 0, &face))
+        return false;
+    FT_Set_Pixel_Sizes(face, 0, SDF_GLYPH_SIZE);
+
+    std::vector<char> records;
+    uint32_t count = 0;
+    for (uint32_t code = 32; code < 127; ++code)
+    {
+        GlyphBitmap glyph;
+        if (!RasterizeGlyph(face, code, glyph))
+            continue;
+        WriteGlyphRecord(records, code, glyph);
+        ++count;
+    }
+    PackGlyphHeader header = { SDF_GLYPH_SIZE, SDF_SPREAD, count, GlyphCapHeight(face) };
+    FT_Done_Face(face);
+
+    std::vector<char> blob(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1));
+    blob.insert(blob.end(), records.begin(), records.end());
+    pack.Add(file, PACK_GLYPHS, 0, 0, blob.data(), blob.size());
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output = "assets.pack";
+    bool compress = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--uncompressed") == 0)
+            compress = false;
+        else
+            output = argv[i];
+    }
+    AssetPackWriter pack;
+    unsigned int packed = 0, failed = 0;
+    auto report = [&packed, &failed](bool success, const std::string &file) {
+        if (success)
+            ++packed;
+        else
+        {
+            ++failed;
+            std::cout << "ERROR::PACKER: Could not pack " << file << std::endl;
+        }
+    };
+
+    for (const std::string &file : listFiles("textures", { ".png", ".jpg", ".jpeg" }))
+        report(packTexture(pack, file, compress), file);
+    for (const std::string &file : listFiles("shaders", { ".vs", ".fs", ".gs" }))
+        report(packShader(pack, file), file);
+    for (const std::string &file : listFiles("levels", { ".lvl" }))
+        report(packLevel(pack, file), file);
+
+    FT_Library ft;
+    if (FT_Init_FreeType(&ft))
+    {
+        std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+        return 1;
+    }
+#ifdef HAVE_FT_SDF
+    int spread = SDF_SPREAD;
+    FT_Property_Set(ft, "sdf", "spread", &spread);
+#endif
+    for (const std::string &file : listFiles("fonts", { ".ttf" }))
+        report(packGlyphs(pack, ft, file), file);
+    FT_Done_FreeType(ft);
+
+    if (!pack.Write(output))
+    {
+        std::cout << "ERROR::PACKER: Could not write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Packed " << packed << " assets into " << output << (failed ? ", some failed" : "") << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+// Times loading a level, parsing the text into tiles and building the bricks, on generated square
+// levels of up to 500x500 tiles. For comparison it also runs a copy of the former loader, which
+// passed the nested tile rows to every brick by value; that one is quadratic in the level size and
+// only runs on the smaller levels. Parsing alone is timed on levels of several megabytes, against
+// the former getline and istringstream parser.
+//
+// usage, from the repository root: level_benchmark [runs per size, default 5]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "game_level.h"
+#include "level_parser.h"
+#include "resource_manager.h"
+
+// larger levels would take the former loader minutes
+static const unsigned int LEGACY_MAX_SIZE = 200;
+
+// a level of random bricks, about a third of the tiles left empty
+static std::string generateLevel(unsigned int size)
+{
+    std::string file = (std::filesystem::temp_directory_path() / ("breakout_" + std::to_string(size) + ".lvl")).string();
+    std::ofstream stream(file);
+    std::srand(size);
+    for (unsigned int y = 0; y < size; ++y)
+    {
+        for (unsigned int x = 0; x < size; ++x)
+            stream << (std::rand() % 3 == 0 ? 0 : std::rand() % 5 + 1) << (x + 1 < size ? " " : "");
+        // stray trailing whitespace like the shipped levels have
+        stream << (y % 2 ? " \t\n" : "\n");
+    }
+    return file;
+}
+
+// the loader as it was: every brick got its own copy of the whole grid
+static void legacyColoring(std::vector<std::vector<unsigned int>> tileData, float unit_width, float unit_height,
+                            unsigned int x, unsigned int y, std::vector<GameObject> &bricks, Texture2D sprite)
+{
+    glm::vec3 color = glm::vec3(1.0f);
+    if (tileData[y][x] == 2)
+        color = glm::vec3(0.11f, 0.2f, 0.804f);
+    else if (tileData[y][x] == 3)
+        color = glm::vec3(0.2f, 0.649f, 0.9f);
+    else if (tileData[y][x] == 4)
+        color = glm::vec3(0.581f, 0.169f, 0.827f);
+    else if (tileData[y][x] == 5)
+        color = glm::vec3(0.350f, 0.0f, 0.610f);
+    bricks.push_back(GameObject(glm::vec2(unit_width * x, unit_height * y), glm::vec2(unit_width, unit_height), sprite, color));
+}
+
+static void legacyInit(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight,
+                        std::vector<GameObject> &bricks, Texture2D brick, Texture2D solid)
+{
+    unsigned int width = tileData[0].size();
+    unsigned int height = tileData.size();
+    float unit_width = levelWidth / static_cast<float>(width);
+    float unit_height = levelHeight / height;
+    for (unsigned int y = 0; y < height; ++y)
+        for (unsigned int x = 0; x < width; ++x)
+        {
+            if (tileData[y][x] == 1)
+            {
+                GameObject obj(glm::vec2(unit_width * x, unit_height * y), glm::vec2(unit_width, unit_height), solid,
+                                glm::vec3(0.8f, 0.8f, 0.7f));
+                obj.IsSolid = true;
+                bricks.push_back(obj);
+            }
+            else if (tileData[y][x] > 1)
+                legacyColoring(tileData, unit_width, unit_height, x, y, bricks, brick);
+        }
+}
+
+static std::vector<std::vector<unsigned int>> legacyParse(const char *file)
+{
+    unsigned int tileCode;
+    std::string line;
+    std::ifstream fstream(file);
+    std::vector<std::vector<unsigned int>> tileData;
+    while (std::getline(fstream, line))
+    {
+        std::istringstream sstream(line);
+        std::vector<unsigned int> row;
+        while (sstream >> tileCode)
+            row.push_back(tileCode);
+        tileData.push_back(row);
+    }
+    return tileData;
+}
+
+static size_t legacyLoad(const char *file, unsigned int levelWidth, unsigned int levelHeight)
+{
+    std::vector<std::vector<unsigned int>> tileData = legacyParse(file);
+    std::vector<GameObject> bricks;
+    legacyInit(tileData, levelWidth, levelHeight, bricks, ResourceManager::GetTexture("brick"),
+                ResourceManager::GetTexture("brick_solid"));
+    // the level was then pushed into the game's list by value
+    std::vector<std::vector<GameObject>> levels;
+    levels.push_back(bricks);
+    return levels.back().size();
+}
+
+// average milliseconds of a load over the runs
+template <typename Load>
+static double timeLoads(unsigned int runs, Load load)
+{
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < runs; ++i)
+        load();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / runs;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int runs = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 5;
+
+    for (unsigned int size : { 1000u, 2000u, 3000u })
+    {
+        std::string file = generateLevel(size);
+        LevelTiles tiles;
+        LevelParseError error;
+        double ms = timeLoads(runs, [&]() { ReadLevelFile(file.c_str(), tiles, error); });
+        double mb = std::filesystem::file_size(file) / (1024.0 * 1024.0);
+        std::cout << "parse " << size << "x" << size << " (" << mb << " MB): " << ms << " ms, " << mb / ms * 1000.0 
+                    << " MB/s, former parser " << timeLoads(runs, [&]() { legacyParse(file.c_str()); }) << " ms" << std::endl;
+        std::filesystem::remove(file);
+    }
+
+    // the bricks need their textures, loaded through a hidden window's context
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, false);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "level_benchmark", nullptr, nullptr);
+    if (!window)
+    {
+        std::cout << "ERROR::BENCHMARK: Could not create an OpenGL context" << std::endl;
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return 1;
+    }
+    ResourceManager::LoadTexture("textures/brick.png", false, "brick");
+    ResourceManager::LoadTexture("textures/brick_solid.png", false, "brick_solid");
+
+    const unsigned int levelWidth = 800, levelHeight = 300;
+    for (unsigned int size : { 50u, 100u, 200u, 500u })
+    {
+        std::string file = generateLevel(size);
+        GameLevel level;
+        double ms = timeLoads(runs, [&]() { level.Load(file.c_str(), levelWidth, levelHeight); });
+        std::cout << size << "x" << size << " (" << level.Bricks.size() << " bricks): " << ms << " ms";
+        if (size <= LEGACY_MAX_SIZE)
+            std::cout << ", former loader " << timeLoads(runs, [&]() { legacyLoad(file.c_str(), levelWidth, levelHeight); })
+                        << " ms";
+        std::cout << std::endl;
+        std::filesystem::remove(file);
+    }
+
+    ResourceManager::Clear();
+    TextureRegistry::Clear();
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,56 @@
+// lvlc: compiles text levels into the binary format of src/level_parser.h, written next to each
+// one with the extension ".lvlc". GameLevel::Load picks the compiled file up while it is newer
+// than the text, and a build may ship only the compiled levels.
+//
+// usage, from the repository root: lvlc level.lvl [level.lvl ...]
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "level_parser.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: lvlc level.lvl [level.lvl ...]" << std::endl;
+        return 1;
+    }
+    unsigned int failed = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *file = argv[i];
+        LevelTiles tiles;
+        LevelParseError error;
+        if (!ReadLevelFile(file, tiles, error))
+        {
+            std::cout << "ERROR::LVLC: " << file;
+            if (error.Line > 0)
+                std::cout << ":" << error.Line << ":" << error.Column;
+            std::cout << ": " << error.Message << std::endl;
+            ++failed;
+            continue;
+        }
+        std::vector<unsigned char> compiled = CompileLevel(tiles.View());
+        if (compiled.empty())
+        {
+            std::cout << "ERROR::LVLC: " << file << ": more than 256 distinct tile codes" << std::endl;
+            ++failed;
+            continue;
+        }
+        std::string output = CompiledLevelPath(file);
+        std::ofstream stream(output, std::ios::binary);
+        stream.write(reinterpret_cast<const char*>(compiled.data()), compiled.size());
+        if (!stream)
+        {
+            std::cout << "ERROR::LVLC: Could not write " << output << std::endl;
+            ++failed;
+            continue;
+        }
+        const LevelFileHeader *header = reinterpret_cast<const LevelFileHeader*>(compiled.data());
+        std::cout << output << ": " << tiles.Width << "x" << tiles.Height << ", " << header->BitsPerTile 
+                    << "-bit tiles, " << compiled.size() << " bytes" << std::endl;
+    }
+    return failed ? 1 : 0;
+}